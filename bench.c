@@ -0,0 +1,312 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Every heap allocation of yagi is counted
+static size_t bench_allocs = 0;
+
+static void* bench_malloc(size_t size) {
+    bench_allocs++;
+    return malloc(size);
+}
+
+static void* bench_realloc(void* ptr, size_t size) {
+    bench_allocs++;
+    return realloc(ptr, size);
+}
+
+#define YAGI_MALLOC(size) bench_malloc(size)
+#define YAGI_REALLOC(ptr, size) bench_realloc(ptr, size)
+#define YAGI_FREE(ptr) free(ptr)
+
+#define YAGI_IMPLEMENTATION
+#include "yagi.h"
+
+#define WARMUP_FRAMES 10
+#define DEFAULT_FRAMES 200
+// Slowdown against the baseline reported as a regression
+#define DEFAULT_THRESHOLD 0.10
+
+typedef struct {
+    const char* name;
+    // Widgets emitted every frame, for ns/widget
+    size_t widgets;
+    void (*setup)(void);
+    void (*frame)(void);
+    void (*cleanup)(void);
+}Scenario;
+
+typedef struct {
+    double ns_per_frame;
+    double ns_per_widget;
+    double draw_calls;
+    double allocs_per_frame;
+}Result;
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+#define TEXT_ROWS 10000
+
+static void text_rows_frame(void) {
+    yagi_ui_begin();
+    yagi_begin_layout(LAYOUT_VERT, ((Vector2){10, 10}), 2);
+    for (size_t i = 0; i < TEXT_ROWS; i++) {
+        yagi_text("row %zu", i);
+    }
+    yagi_end_layout();
+    yagi_ui_end();
+}
+
+#define GRID_SIZE 10
+
+static void nested_buttons_frame(void) {
+    yagi_ui_begin();
+    yagi_begin_layout(LAYOUT_VERT, ((Vector2){10, 10}), 4);
+    for (size_t i = 0; i < GRID_SIZE; i++) {
+        yagi_push_id(i);
+        yagi_begin_sublayout(LAYOUT_HORZ, 4);
+        for (size_t j = 0; j < GRID_SIZE; j++) {
+            yagi_push_id(j);
+            yagi_begin_sublayout(LAYOUT_VERT, 2);
+            for (size_t k = 0; k < GRID_SIZE; k++) {
+                yagi_push_id(k);
+                yagi_button("button");
+                yagi_pop_id();
+            }
+            yagi_end_layout();
+            yagi_pop_id();
+        }
+        yagi_end_layout();
+        yagi_pop_id();
+    }
+    yagi_end_layout();
+    yagi_ui_end();
+}
+
+#define DROPDOWN_LABELS 5000
+
+static char* dropdown_labels[DROPDOWN_LABELS];
+static int dropdown_selected = -1;
+
+static void dropdown_frame(void) {
+    yagi_ui_begin();
+    yagi_begin_layout(LAYOUT_VERT, ((Vector2){10, 10}), 10);
+    yagi_dropdown(&dropdown_selected, dropdown_labels, DROPDOWN_LABELS);
+    yagi_end_layout();
+    yagi_ui_end();
+}
+
+static void dropdown_setup(void) {
+    for (size_t i = 0; i < DROPDOWN_LABELS; i++) {
+        dropdown_labels[i] = malloc(32);
+        snprintf(dropdown_labels[i], 32, "label %zu", i);
+    }
+
+    // Click the dropdown open and move the mouse away from it. Hit testing uses the
+    // previous frame, so the dropdown is laid out once before the click.
+    yagi_headless_set_mouse((Vector2){15, 15});
+    dropdown_frame();
+    yagi_headless_set_mouse_button(MOUSE_BUTTON_LEFT, true);
+    dropdown_frame();
+    yagi_headless_set_mouse_button(MOUSE_BUTTON_LEFT, false);
+    dropdown_frame();
+    yagi_headless_set_mouse((Vector2){1000, 10});
+}
+
+static void dropdown_cleanup(void) {
+    for (size_t i = 0; i < DROPDOWN_LABELS; i++) {
+        free(dropdown_labels[i]);
+    }
+    yagi_ui.focus = 0;
+}
+
+#define INPUT_CODEPOINTS 100000
+
+static InputBuffer input_buffer = {0};
+
+static void input_frame(void) {
+    yagi_ui_begin();
+    yagi_begin_layout(LAYOUT_VERT, ((Vector2){10, 10}), 10);
+    yagi_input(400, &input_buffer);
+    yagi_end_layout();
+    yagi_ui_end();
+}
+
+static void input_setup(void) {
+    char* text = malloc(INPUT_CODEPOINTS + 1);
+    for (size_t i = 0; i < INPUT_CODEPOINTS; i++) {
+        text[i] = 'a' + i % 26;
+    }
+    text[INPUT_CODEPOINTS] = 0;
+    yagi_input_buffer_set_text(&input_buffer, text);
+    free(text);
+
+    // Focus the input with a click
+    yagi_headless_set_mouse((Vector2){15, 15});
+    input_frame();
+    yagi_headless_set_mouse_button(MOUSE_BUTTON_LEFT, true);
+    input_frame();
+    yagi_headless_set_mouse_button(MOUSE_BUTTON_LEFT, false);
+    input_frame();
+}
+
+static void input_cleanup(void) {
+    yagi_input_buffer_free(&input_buffer);
+    yagi_ui.focus = 0;
+}
+
+#define TABLE_ROWS 1000000
+
+static YagiTableColumn table_columns[] = {
+    { "index", 100 },
+    { "value", 200 },
+};
+static YagiScroll table_scroll = {0};
+
+static const char* table_cell(void* user, size_t row, size_t column, char* buf, size_t buf_size) {
+    (void)user;
+    if (column == 0) snprintf(buf, buf_size, "%zu", row);
+    else snprintf(buf, buf_size, "value %zu", row * 7);
+    return buf;
+}
+
+static void table_frame(void) {
+    YagiTable table = {
+        .columns = table_columns,
+        .column_count = 2,
+        .row_count = TABLE_ROWS,
+        .cell = table_cell,
+    };
+    yagi_ui_begin();
+    yagi_begin_layout(LAYOUT_VERT, ((Vector2){10, 10}), 10);
+    yagi_table(((Vector2){600, 600}), &table, &table_scroll);
+    yagi_end_layout();
+    yagi_ui_end();
+}
+
+static void table_setup(void) {
+    // Somewhere in the middle of the rows
+    table_scroll.offset.y = 1e7;
+}
+
+static Scenario scenarios[] = {
+    { "text_rows", TEXT_ROWS, NULL, text_rows_frame, NULL },
+    { "nested_buttons", GRID_SIZE * GRID_SIZE * GRID_SIZE, NULL, nested_buttons_frame, NULL },
+    { "dropdown", 1, dropdown_setup, dropdown_frame, dropdown_cleanup },
+    { "input", 1, input_setup, input_frame, input_cleanup },
+    { "table", 1, table_setup, table_frame, NULL },
+};
+#define SCENARIOS_COUNT (sizeof(scenarios)/sizeof(scenarios[0]))
+
+static Result run_scenario(Scenario* scenario, size_t frames) {
+    if (scenario->setup != NULL) scenario->setup();
+    for (size_t i = 0; i < WARMUP_FRAMES; i++) {
+        scenario->frame();
+    }
+
+    size_t draw_calls = 0;
+    uint64_t elapsed = 0;
+    bench_allocs = 0;
+    for (size_t i = 0; i < frames; i++) {
+        uint64_t start = now_ns();
+        scenario->frame();
+        elapsed += now_ns() - start;
+        draw_calls += yagi_headless.call_count;
+    }
+
+    Result result = {
+        .ns_per_frame = (double)elapsed / frames,
+        .draw_calls = (double)draw_calls / frames,
+        .allocs_per_frame = (double)bench_allocs / frames,
+    };
+    result.ns_per_widget = result.ns_per_frame / scenario->widgets;
+
+    if (scenario->cleanup != NULL) scenario->cleanup();
+    return result;
+}
+
+// Reads ns_per_frame of scenario from a file written by a previous run. Returns a negative value if it is missing.
+static double baseline_ns_per_frame(const char* path, const char* scenario) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Failed to open baseline: %s\n", path);
+        exit(1);
+    }
+
+    char key[128];
+    snprintf(key, sizeof(key), "\"scenario\":\"%s\"", scenario);
+
+    double ns = -1;
+    char line[1024];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (strstr(line, key) == NULL) continue;
+        const char* value = strstr(line, "\"ns_per_frame\":");
+        if (value != NULL) ns = atof(value + strlen("\"ns_per_frame\":"));
+    }
+
+    fclose(file);
+    return ns;
+}
+
+static void usage(const char* program) {
+    fprintf(stderr, "Usage: %s [--frames N] [--baseline FILE] [--threshold RATIO] [SCENARIO...]\n", program);
+}
+
+int main(int argc, char* argv[]) {
+    const char* program = argv[0];
+    size_t frames = DEFAULT_FRAMES;
+    const char* baseline = NULL;
+    double threshold = DEFAULT_THRESHOLD;
+    const char* only[SCENARIOS_COUNT] = {0};
+    size_t only_count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+        } else if (argv[i][0] != '-' && only_count < SCENARIOS_COUNT) {
+            only[only_count++] = argv[i];
+        } else {
+            usage(program);
+            return 1;
+        }
+    }
+    if (frames == 0) frames = 1;
+
+    yagi_ui_set_backend(&yagi_backend_headless);
+
+    bool regressed = false;
+    for (size_t i = 0; i < SCENARIOS_COUNT; i++) {
+        Scenario* scenario = &scenarios[i];
+
+        bool selected = only_count == 0;
+        for (size_t j = 0; j < only_count; j++) {
+            if (strcmp(only[j], scenario->name) == 0) selected = true;
+        }
+        if (!selected) continue;
+
+        Result result = run_scenario(scenario, frames);
+        printf("{\"scenario\":\"%s\",\"frames\":%zu,\"ns_per_frame\":%.0f,\"ns_per_widget\":%.2f,\"draw_calls\":%.0f,\"allocs_per_frame\":%.2f}\n",
+               scenario->name, frames, result.ns_per_frame, result.ns_per_widget, result.draw_calls, result.allocs_per_frame);
+
+        if (baseline != NULL) {
+            double base = baseline_ns_per_frame(baseline, scenario->name);
+            if (base > 0 && result.ns_per_frame > base * (1 + threshold)) {
+                fprintf(stderr, "%s: %.0f ns/frame, baseline %.0f ns/frame (+%.1f%%)\n",
+                        scenario->name, result.ns_per_frame, base, (result.ns_per_frame / base - 1) * 100);
+                regressed = true;
+            }
+        }
+    }
+
+    yagi_headless_free();
+    return regressed ? 1 : 0;
+}
@@ -8,12 +8,12 @@ void cflags(Cmd* cmd, bool debug) {
     if (debug) {
         cmd_push_str(cmd, "-ggdb", "-DYAGI_DEBUG");
     } else {
-        cmd_push_str(cmd, "-O2");
+        cmd_push_str(cmd, "-O2", "-DYAGI_NO_STATS");
     }
 }
 
 void libs(Cmd* cmd) {
-    cmd_push_str(cmd, "-lraylib", "-lm");
+    cmd_push_str(cmd, "-lraylib", "-lm", "-lpthread");
 }
 
 const char* examples[][2] = {
@@ -22,33 +22,73 @@ const char* examples[][2] = {
 };
 #define EXAMPLES_COUNT (sizeof(examples)/sizeof(examples[0]))
 
-bool build_examples(Cmd* cmd) {
+void build_examples(Build* build, Cmd* cmd) {
     for (size_t i = 0; i < EXAMPLES_COUNT; i++) {
         if (need_rebuild1(examples[i][1], examples[i][0])) {
             cc(cmd);
             cflags(cmd, true);
             cmd_push_str(cmd, "-o", examples[i][1], examples[i][0]);
             libs(cmd);
-            if (!cmd_run_sync_and_reset(cmd)) return false;
+            build_add(build, cmd);
         }
     }
-    return true;
+}
+
+void build_yagi(Build* build, Cmd* cmd) {
+    if (need_rebuild1("./build/yagi.o", "yagi.h")) {
+        cc(cmd);
+        cflags(cmd, true);
+        cmd_push_str(cmd, "-c", "-o", "./build/yagi.o", "yagi.c");
+        build_add(build, cmd);
+    }
+}
+
+// Frame throughput benchmark on the headless backend, built with optimizations. Returns the job,
+// which does nothing if the benchmark is up to date
+size_t build_bench(Build* build, Cmd* cmd) {
+    if (need_rebuild1("./build/bench", "./bench.c") || need_rebuild1("./build/bench", "./yagi.h")) {
+        cc(cmd);
+        cflags(cmd, false);
+        cmd_push_str(cmd, "-o", "./build/bench", "./bench.c");
+        libs(cmd);
+    }
+    return build_add(build, cmd);
 }
 
 int main(int argc, char* argv[]) {
     Cmd cmd = {0};
     build_yourself(&cmd, argc, argv);
+    pop_argv(&argc, &argv);
+
+    // -j N runs up to N commands at once, as many as there are cores by default
+    size_t max_jobs = 0;
+    if (argc > 0 && strncmp(argv[0], "-j", 2) == 0) {
+        const char* jobs = pop_argv(&argc, &argv) + 2;
+        if (jobs[0] == 0 && argc > 0) jobs = pop_argv(&argc, &argv);
+        max_jobs = strtoul(jobs, NULL, 10);
+    }
 
     if (!create_dir_if_not_exists("./build")) return 1;
 
-    if (!build_examples(&cmd)) return 1;
+    Build build = {0};
+    // ./cbuild bench [args...] builds and runs the benchmark, passing it the rest of the arguments
+    if (argc > 0 && strcmp(argv[0], "bench") == 0) {
+        pop_argv(&argc, &argv);
+        size_t bench = build_bench(&build, &cmd);
 
-    if (need_rebuild1("./build/yagi.o", "yagi.h")) {
-        cc(&cmd);
-        cflags(&cmd, true);
-        cmd_push_str(&cmd, "-c", "-o", "./build/yagi.o", "yagi.c");
-        if (!cmd_run_sync_and_reset(&cmd)) return 1;
+        cmd_push_str(&cmd, "./build/bench");
+        for (int i = 0; i < argc; i++) {
+            cmd_push_str(&cmd, argv[i]);
+        }
+        size_t run = build_add(&build, &cmd);
+        build_depend(&build, run, bench);
+    } else {
+        build_examples(&build, &cmd);
+        build_yagi(&build, &cmd);
     }
 
-    return 0;
+    bool ok = build_run(&build, max_jobs);
+    build_free(&build);
+    free(cmd.items);
+    return ok ? 0 : 1;
 }
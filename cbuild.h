@@ -24,7 +24,9 @@
 #ifndef CBUILD_H
 #define CBUILD_H
 #include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <assert.h>
 
 typedef struct {
@@ -45,14 +47,66 @@ typedef struct {
     size_t capacity;
 }Pids;
 
+typedef enum {
+    JOB_WAITING,
+    JOB_RUNNING,
+    JOB_DONE,
+    JOB_FAILED,
+}JobState;
+
+// A target of a Build. Its command runs once the jobs it depends on are done. A job
+// without a command is a target that is up to date, or only groups its dependencies.
+typedef struct {
+    Cmd cmd;
+    size_t* deps;
+    size_t dep_count;
+    size_t dep_capacity;
+    JobState state;
+    Pid pid;
+}Job;
+
+// A graph of jobs, run in parallel by build_run
+typedef struct {
+    Job* items;
+    size_t count;
+    size_t capacity;
+}Build;
+
+// A path split into its directory and its name, which are offsets into the names of Files
 typedef struct {
-    char value[4069];
+    // Index into the directories of Files
+    uint32_t dir;
+    uint32_t name;
 }File;
 
+#define FILES_NOT_FOUND ((size_t)-1)
+
+// A list of paths. Each directory is stored once and files only store their name,
+// so a path takes a few bytes more than its name. Paths are looked up with a hash table.
 typedef struct {
     File* items;
     size_t count;
     size_t capacity;
+
+    // Directories, with the trailing '/', and file names, each terminated with 0
+    char* names;
+    size_t names_size;
+    size_t names_capacity;
+    // Bytes of names that are no longer used
+    size_t names_garbage;
+
+    // Offsets of the directories into names
+    uint32_t* dirs;
+    size_t dir_count;
+    size_t dir_capacity;
+
+    // Hash tables of index + 1 of the directories and of the files
+    uint32_t* dir_slots;
+    size_t dir_slot_capacity;
+    uint32_t* slots;
+    size_t slot_capacity;
+    // Used slots, including removed ones
+    size_t slot_used;
 }Files;
 
 // Pops the first argument from the argv array
@@ -107,12 +161,52 @@ void pids_append_many(Pids* pids, Pid* pid_items, size_t pid_count);
 // Waits for all Pids and returns if all were successful
 bool pids_wait(Pids* pids);
 
+// Adds a job that runs the cmd and resets the cmd. An empty cmd adds a job that does nothing. Returns the job
+size_t build_add(Build* build, Cmd* cmd);
+// Makes job wait for dep to be done
+void build_depend(Build* build, size_t job, size_t dep);
+// Runs the jobs, at most max_jobs at once, or as many as there are cores if it is 0. Reaps whichever
+// job finishes first and starts the jobs it unblocks right away. After a job fails no jobs are
+// started and the running ones are waited for. Returns if all jobs were successful
+bool build_run(Build* build, size_t max_jobs);
+void build_free(Build* build);
+
 // Resizes a Files to fit the specified count
 void files_maybe_resize(Files* files, size_t count);
-// Appends a File to Files
-void files_append(Files* files, File file);
-// Appends many Files to Files
-void files_append_many(Files* files, File* file_items, size_t file_count);
+// Appends a path to Files, even if it is already there
+void files_append(Files* files, const char* path);
+// Appends many paths to Files
+void files_append_many(Files* files, const char** paths, size_t path_count);
+// Appends a path to Files if it is not there yet. Returns true if it was appended
+bool files_add(Files* files, const char* path);
+// Returns the index of a path in Files, or FILES_NOT_FOUND
+size_t files_find(const Files* files, const char* path);
+
+// Returns the name of the i-th path. It is valid until Files is modified
+const char* files_name(const Files* files, size_t i);
+// Returns the directory of the i-th path with the trailing '/', or "". It is valid until Files is modified
+const char* files_dir(const Files* files, size_t i);
+// Writes the i-th path to buf and returns its length. If it is buf_size or more, the path was truncated
+size_t files_path(const Files* files, size_t i, char* buf, size_t buf_size);
+
+// Removes the i-th path, the last path is moved into its place
+void files_remove_at(Files* files, size_t i);
+// Removes a path and returns true if it was in Files
+bool files_remove(Files* files, const char* path);
+// Removes every path inside of the directories, which have no trailing '/'
+void files_remove_in_dirs(Files* files, const char** dirs, size_t dir_count);
+// Returns the index of a directory, which has no trailing '/', to compare with File.dir, or FILES_NOT_FOUND
+size_t files_find_dir(const Files* files, const char* dir);
+// Renames the directory from to to in every path inside of it. Both have no trailing '/'
+void files_rename_dir(Files* files, const char* from, const char* to);
+// Removes every path and keeps the memory
+void files_clear(Files* files);
+void files_free(Files* files);
+
+// Writes Files with its hash tables, so files_load does not hash the paths again. Returns false on a write error
+bool files_save(const Files* files, FILE* f);
+// Loads Files written by files_save from memory, e.g. a mapped file. Returns the bytes it read, or 0 if they are not valid
+size_t files_load(Files* files, const void* data, size_t size);
 
 void files_list_null(Files* files, ...);
 #define files_list(files, ...) files_list_null(files, __VA_ARGS__, NULL)
@@ -239,8 +333,10 @@ char* path_with_ext(const char* path, const char* ext) {
 bool need_rebuild(const char* target, Files* srcs) {
     if (srcs == NULL) return true;
 
+    char path[4096];
     for (size_t i = 0; i < srcs->count; ++i) {
-        if (is_path_modified_after(srcs->items[i].value, target)) return true;
+        files_path(srcs, i, path, sizeof(path));
+        if (is_path_modified_after(path, target)) return true;
     }
 
     return false;
@@ -358,9 +454,6 @@ int cmd_run_async(Cmd* cmd) {
         }
         assert(0 && "unreachable");
     }
-    if (cmd->items[cmd->count - 2] != NULL) {
-        cmd->count--;
-    }
 
     return pid;
 }
@@ -395,6 +488,120 @@ bool pids_wait(Pids* pids) {
     return success;
 }
 
+size_t build_add(Build* build, Cmd* cmd) {
+    if (build->count == build->capacity) {
+        build->capacity = build->capacity == 0 ? 16 : build->capacity * 2;
+        build->items = realloc(build->items, sizeof(*build->items) * build->capacity);
+        assert(build->items);
+    }
+    Job* job = &build->items[build->count];
+    *job = (Job) {0};
+    // One more for the NULL that cmd_run_async appends
+    job->cmd.capacity = cmd->count + 1;
+    job->cmd.items = malloc(sizeof(*job->cmd.items) * job->cmd.capacity);
+    assert(job->cmd.items);
+    if (cmd->count > 0) memcpy(job->cmd.items, cmd->items, sizeof(*cmd->items) * cmd->count);
+    job->cmd.count = cmd->count;
+    cmd->count = 0;
+    return build->count++;
+}
+
+void build_depend(Build* build, size_t job, size_t dep) {
+    assert(job < build->count && dep < build->count);
+    Job* j = &build->items[job];
+    if (j->dep_count == j->dep_capacity) {
+        j->dep_capacity = j->dep_capacity == 0 ? 4 : j->dep_capacity * 2;
+        j->deps = realloc(j->deps, sizeof(*j->deps) * j->dep_capacity);
+        assert(j->deps);
+    }
+    j->deps[j->dep_count++] = dep;
+}
+
+// Returns if every job that job depends on is done
+static bool build__ready(Build* build, Job* job) {
+    for (size_t i = 0; i < job->dep_count; i++) {
+        if (build->items[job->deps[i]].state != JOB_DONE) return false;
+    }
+    return true;
+}
+
+bool build_run(Build* build, size_t max_jobs) {
+    if (max_jobs == 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        max_jobs = cores > 0 ? (size_t)cores : 1;
+    }
+
+    bool failed = false;
+    size_t running = 0;
+    while (true) {
+        // Jobs without a command finish right away and may unblock others, so this repeats until nothing changes
+        bool started = true;
+        while (!failed && started) {
+            started = false;
+            for (size_t i = 0; i < build->count && running < max_jobs; i++) {
+                Job* job = &build->items[i];
+                if (job->state != JOB_WAITING || !build__ready(build, job)) continue;
+                if (job->cmd.count == 0) {
+                    job->state = JOB_DONE;
+                } else {
+                    job->pid = cmd_run_async(&job->cmd);
+                    job->state = JOB_RUNNING;
+                    running++;
+                }
+                started = true;
+            }
+        }
+        if (running == 0) break;
+
+        int wstatus = 0;
+        Pid pid = waitpid(-1, &wstatus, 0);
+        if (pid < 0) {
+            if (errno == EINTR) continue;
+            logf_error(stderr, "could not wait on commands: %s\n", strerror(errno));
+            return false;
+        }
+        if (!WIFEXITED(wstatus) && !WIFSIGNALED(wstatus)) continue;
+
+        // Children that are not jobs of this build are ignored
+        for (size_t i = 0; i < build->count; i++) {
+            Job* job = &build->items[i];
+            if (job->state != JOB_RUNNING || job->pid != pid) continue;
+
+            running--;
+            if (WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0) {
+                job->state = JOB_DONE;
+            } else {
+                if (WIFEXITED(wstatus)) {
+                    logf_error(stderr, "%s exited with exit code %d\n", job->cmd.items[0], WEXITSTATUS(wstatus));
+                } else {
+                    logf_error(stderr, "%s was terminated\n", job->cmd.items[0]);
+                }
+                job->state = JOB_FAILED;
+                failed = true;
+            }
+            break;
+        }
+    }
+
+    if (failed) return false;
+    for (size_t i = 0; i < build->count; i++) {
+        if (build->items[i].state != JOB_DONE) {
+            logf_error(stderr, "jobs depend on each other in a cycle\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+void build_free(Build* build) {
+    for (size_t i = 0; i < build->count; i++) {
+        free(build->items[i].cmd.items);
+        free(build->items[i].deps);
+    }
+    free(build->items);
+    *build = (Build) {0};
+}
+
 bool pid_wait(int pid) {
     while (1) {
         int wstatus = 0;
@@ -422,6 +629,169 @@ bool pid_wait(int pid) {
     return true;
 }
 
+#define FILES__TOMBSTONE UINT32_MAX
+
+static uint64_t files__hash(const char* str, size_t len, uint64_t hash) {
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t)str[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+static uint64_t files__file_hash(uint32_t dir, const char* name, size_t name_len) {
+    return files__hash(name, name_len, 14695981039346656037ull ^ ((uint64_t)dir * 0x9E3779B97F4A7C15ull));
+}
+
+// Length of the directory of path, including the trailing '/'
+static size_t files__dir_len(const char* path, size_t len) {
+    while (len > 0 && path[len - 1] != '/') len--;
+    return len;
+}
+
+static uint32_t files__push_name(Files* files, const char* str, size_t len) {
+    if (files->names_size + len + 1 > files->names_capacity) {
+        if (files->names_capacity == 0) files->names_capacity = 4096;
+        while (files->names_size + len + 1 > files->names_capacity) {
+            files->names_capacity *= 2;
+        }
+        files->names = realloc(files->names, files->names_capacity);
+        assert(files->names);
+    }
+    assert(files->names_size + len + 1 <= UINT32_MAX && "Too many paths in Files");
+
+    uint32_t offset = files->names_size;
+    memcpy(files->names + offset, str, len);
+    files->names[offset + len] = 0;
+    files->names_size += len + 1;
+    return offset;
+}
+
+static size_t files__dir_find(const Files* files, const char* dir, size_t len) {
+    if (files->dir_slot_capacity == 0) return FILES_NOT_FOUND;
+    size_t mask = files->dir_slot_capacity - 1;
+    for (size_t i = files__hash(dir, len, 14695981039346656037ull) & mask;; i = (i + 1) & mask) {
+        uint32_t slot = files->dir_slots[i];
+        if (slot == 0) return FILES_NOT_FOUND;
+        if (slot == FILES__TOMBSTONE) continue;
+        const char* name = files->names + files->dirs[slot - 1];
+        if (strncmp(name, dir, len) == 0 && name[len] == 0) return slot - 1;
+    }
+}
+
+static void files__dir_slot_put(Files* files, size_t dir) {
+    const char* name = files->names + files->dirs[dir];
+    size_t mask = files->dir_slot_capacity - 1;
+    size_t i = files__hash(name, strlen(name), 14695981039346656037ull) & mask;
+    while (files->dir_slots[i] != 0 && files->dir_slots[i] != FILES__TOMBSTONE) i = (i + 1) & mask;
+    files->dir_slots[i] = dir + 1;
+}
+
+// The directory table is rebuilt instead of keeping tombstones, directories are renamed rarely
+static void files__dir_slots_rebuild(Files* files, size_t capacity) {
+    free(files->dir_slots);
+    files->dir_slot_capacity = capacity;
+    files->dir_slots = calloc(capacity, sizeof(*files->dir_slots));
+    assert(files->dir_slots);
+    for (size_t dir = 0; dir < files->dir_count; dir++) {
+        files__dir_slot_put(files, dir);
+    }
+}
+
+static uint32_t files__dir_intern(Files* files, const char* dir, size_t len) {
+    size_t found = files__dir_find(files, dir, len);
+    if (found != FILES_NOT_FOUND) return found;
+
+    if (files->dir_count >= files->dir_capacity) {
+        files->dir_capacity = files->dir_capacity == 0 ? 64 : files->dir_capacity * 2;
+        files->dirs = realloc(files->dirs, sizeof(*files->dirs) * files->dir_capacity);
+        assert(files->dirs);
+    }
+    files->dirs[files->dir_count++] = files__push_name(files, dir, len);
+
+    if (files->dir_count * 4 > files->dir_slot_capacity * 3) {
+        files__dir_slots_rebuild(files, files->dir_slot_capacity == 0 ? 128 : files->dir_slot_capacity * 2);
+    } else {
+        files__dir_slot_put(files, files->dir_count - 1);
+    }
+    return files->dir_count - 1;
+}
+
+static uint32_t* files__slot(const Files* files, uint32_t dir, const char* name, size_t name_len) {
+    if (files->slot_capacity == 0) return NULL;
+    size_t mask = files->slot_capacity - 1;
+    for (size_t i = files__file_hash(dir, name, name_len) & mask;; i = (i + 1) & mask) {
+        uint32_t slot = files->slots[i];
+        if (slot == 0) return NULL;
+        if (slot == FILES__TOMBSTONE) continue;
+        const File* file = &files->items[slot - 1];
+        const char* file_name = files->names + file->name;
+        if (file->dir == dir && strncmp(file_name, name, name_len) == 0 && file_name[name_len] == 0) return &files->slots[i];
+    }
+}
+
+static void files__slot_put(Files* files, size_t i) {
+    const char* name = files->names + files->items[i].name;
+    size_t mask = files->slot_capacity - 1;
+    size_t j = files__file_hash(files->items[i].dir, name, strlen(name)) & mask;
+    while (files->slots[j] != 0 && files->slots[j] != FILES__TOMBSTONE) j = (j + 1) & mask;
+    if (files->slots[j] == 0) files->slot_used++;
+    files->slots[j] = i + 1;
+}
+
+static void files__slot_remove(Files* files, size_t i) {
+    const char* name = files->names + files->items[i].name;
+    size_t mask = files->slot_capacity - 1;
+    size_t j = files__file_hash(files->items[i].dir, name, strlen(name)) & mask;
+    while (files->slots[j] != i + 1) {
+        assert(files->slots[j] != 0 && "Path is not in Files");
+        j = (j + 1) & mask;
+    }
+    files->slots[j] = FILES__TOMBSTONE;
+}
+
+static void files__slots_rebuild(Files* files) {
+    size_t capacity = 256;
+    while (capacity < (files->count + 1) * 2) capacity *= 2;
+    free(files->slots);
+    files->slot_capacity = capacity;
+    files->slots = calloc(capacity, sizeof(*files->slots));
+    assert(files->slots);
+    files->slot_used = 0;
+    for (size_t i = 0; i < files->count; i++) {
+        files__slot_put(files, i);
+    }
+}
+
+// Copies the directories and names that are still used into a new buffer
+static void files__compact(Files* files) {
+    size_t capacity = files->names_size - files->names_garbage + 1;
+    char* names = malloc(capacity);
+    assert(names);
+    size_t size = 0;
+    for (size_t dir = 0; dir < files->dir_count; dir++) {
+        size_t len = strlen(files->names + files->dirs[dir]) + 1;
+        memcpy(names + size, files->names + files->dirs[dir], len);
+        files->dirs[dir] = size;
+        size += len;
+    }
+    for (size_t i = 0; i < files->count; i++) {
+        size_t len = strlen(files->names + files->items[i].name) + 1;
+        memcpy(names + size, files->names + files->items[i].name, len);
+        files->items[i].name = size;
+        size += len;
+    }
+
+    free(files->names);
+    files->names = names;
+    files->names_size = size;
+    files->names_capacity = capacity;
+    files->names_garbage = 0;
+}
+
+static void files__maybe_compact(Files* files) {
+    if (files->names_garbage > 4096 && files->names_garbage * 2 > files->names_size) files__compact(files);
+}
+
 void files_maybe_resize(Files* files, size_t count) {
     if (files->count + count >= files->capacity) {
         if (files->capacity == 0) files->capacity = PIDS_INIT_CAP;
@@ -432,16 +802,288 @@ void files_maybe_resize(Files* files, size_t count) {
     }
 }
 
-void files_append(Files* files, File file) {
+void files_append(Files* files, const char* path) {
+    size_t len = strlen(path);
+    size_t dir_len = files__dir_len(path, len);
+
     files_maybe_resize(files, 1);
+    File file = {
+        .dir = files__dir_intern(files, path, dir_len),
+        .name = files__push_name(files, path + dir_len, len - dir_len),
+    };
     files->items[files->count++] = file;
+
+    if ((files->slot_used + 1) * 4 > files->slot_capacity * 3) {
+        files__slots_rebuild(files);
+    } else {
+        files__slot_put(files, files->count - 1);
+    }
+}
+
+void files_append_many(Files* files, const char** paths, size_t path_count) {
+    files_maybe_resize(files, path_count);
+    for (size_t i = 0; i < path_count; ++i) {
+        files_append(files, paths[i]);
+    }
+}
+
+bool files_add(Files* files, const char* path) {
+    if (files_find(files, path) != FILES_NOT_FOUND) return false;
+    files_append(files, path);
+    return true;
+}
+
+size_t files_find(const Files* files, const char* path) {
+    size_t len = strlen(path);
+    size_t dir_len = files__dir_len(path, len);
+    size_t dir = files__dir_find(files, path, dir_len);
+    if (dir == FILES_NOT_FOUND) return FILES_NOT_FOUND;
+
+    uint32_t* slot = files__slot(files, dir, path + dir_len, len - dir_len);
+    return slot != NULL ? *slot - 1 : FILES_NOT_FOUND;
+}
+
+const char* files_name(const Files* files, size_t i) {
+    return files->names + files->items[i].name;
+}
+
+const char* files_dir(const Files* files, size_t i) {
+    return files->names + files->dirs[files->items[i].dir];
+}
+
+size_t files_path(const Files* files, size_t i, char* buf, size_t buf_size) {
+    int len = snprintf(buf, buf_size, "%s%s", files_dir(files, i), files_name(files, i));
+    return len < 0 ? 0 : (size_t)len;
+}
+
+void files_remove_at(Files* files, size_t i) {
+    files__slot_remove(files, i);
+    files->names_garbage += strlen(files->names + files->items[i].name) + 1;
+    files->count--;
+    if (i != files->count) {
+        files__slot_remove(files, files->count);
+        files->items[i] = files->items[files->count];
+        files__slot_put(files, i);
+    }
+    files__maybe_compact(files);
+}
+
+bool files_remove(Files* files, const char* path) {
+    size_t i = files_find(files, path);
+    if (i == FILES_NOT_FOUND) return false;
+    files_remove_at(files, i);
+    return true;
 }
 
-void files_append_many(Files* files, File* file_items, size_t file_count) {
-    files_maybe_resize(files, file_count);
-    for (int i = 0; (size_t)i < file_count; ++i) {
-        files->items[files->count++] = file_items[i];
+// Whether the directory, with the trailing '/', is dir or inside of it
+static bool files__dir_in(const char* path, const char* dir, size_t dir_len) {
+    return strncmp(path, dir, dir_len) == 0 && path[dir_len] == '/';
+}
+
+void files_remove_in_dirs(Files* files, const char** dirs, size_t dir_count) {
+    if (dir_count == 0 || files->count == 0) return;
+
+    // Every directory is checked once, then each path only looks up its directory
+    bool* removed = calloc(files->dir_count, sizeof(*removed));
+    assert(removed);
+    for (size_t dir = 0; dir < files->dir_count; dir++) {
+        for (size_t i = 0; i < dir_count && !removed[dir]; i++) {
+            removed[dir] = files__dir_in(files->names + files->dirs[dir], dirs[i], strlen(dirs[i]));
+        }
+    }
+
+    for (size_t i = 0; i < files->count;) {
+        if (removed[files->items[i].dir]) {
+            files_remove_at(files, i);
+        } else {
+            i++;
+        }
+    }
+    free(removed);
+}
+
+size_t files_find_dir(const Files* files, const char* dir) {
+    size_t len = strlen(dir);
+    char* with_slash = malloc(len + 2);
+    assert(with_slash);
+    memcpy(with_slash, dir, len);
+    memcpy(with_slash + len, "/", 2);
+    size_t found = files__dir_find(files, with_slash, len + 1);
+    free(with_slash);
+    return found;
+}
+
+void files_rename_dir(Files* files, const char* from, const char* to) {
+    size_t from_len = strlen(from);
+    size_t to_len = strlen(to);
+    size_t dir_count = files->dir_count;
+    bool renamed_any = false;
+    for (size_t dir = 0; dir < dir_count; dir++) {
+        if (!files__dir_in(files->names + files->dirs[dir], from, from_len)) continue;
+
+        const char* rest = files->names + files->dirs[dir] + from_len;
+        size_t rest_len = strlen(rest);
+        char* renamed = malloc(to_len + rest_len + 1);
+        assert(renamed);
+        memcpy(renamed, to, to_len);
+        memcpy(renamed + to_len, rest, rest_len + 1);
+
+        size_t existing = files__dir_find(files, renamed, to_len + rest_len);
+        if (existing == FILES_NOT_FOUND) {
+            // The files keep their directory index, only its name changes
+            files->names_garbage += from_len + rest_len + 1;
+            files->dirs[dir] = files__push_name(files, renamed, to_len + rest_len);
+            renamed_any = true;
+        } else {
+            // The directory was known before, its files are moved there
+            for (size_t i = 0; i < files->count;) {
+                if (files->items[i].dir != dir) {
+                    i++;
+                    continue;
+                }
+                const char* name = files->names + files->items[i].name;
+                if (files__slot(files, existing, name, strlen(name)) != NULL) {
+                    files_remove_at(files, i);
+                    continue;
+                }
+                files__slot_remove(files, i);
+                files->items[i].dir = existing;
+                files__slot_put(files, i);
+                i++;
+            }
+        }
+        free(renamed);
     }
+    if (renamed_any) files__dir_slots_rebuild(files, files->dir_slot_capacity);
+    files__maybe_compact(files);
+}
+
+void files_clear(Files* files) {
+    files->count = 0;
+    files->names_size = 0;
+    files->names_garbage = 0;
+    files->dir_count = 0;
+    if (files->dir_slots != NULL) memset(files->dir_slots, 0, sizeof(*files->dir_slots) * files->dir_slot_capacity);
+    if (files->slots != NULL) memset(files->slots, 0, sizeof(*files->slots) * files->slot_capacity);
+    files->slot_used = 0;
+}
+
+void files_free(Files* files) {
+    free(files->items);
+    free(files->names);
+    free(files->dirs);
+    free(files->dir_slots);
+    free(files->slots);
+    *files = (Files) {0};
+}
+
+#define FILES__MAGIC "CBFILES1"
+
+// Sizes of the arrays files_save writes, in bytes, in order
+static void files__sections(const uint64_t* counts, uint64_t* sizes) {
+    sizes[0] = counts[0] * sizeof(File);
+    sizes[1] = counts[1];
+    sizes[2] = counts[2] * sizeof(uint32_t);
+    sizes[3] = counts[3] * sizeof(uint32_t);
+    sizes[4] = counts[4] * sizeof(uint32_t);
+}
+
+// Arrays are padded to 8 bytes, so a mapped file can be read in place
+static bool files__write_padded(const void* data, size_t size, FILE* f) {
+    static const char padding[8] = {0};
+    if (size > 0 && fwrite(data, 1, size, f) != size) return false;
+    size_t pad = (8 - size % 8) % 8;
+    return pad == 0 || fwrite(padding, 1, pad, f) == pad;
+}
+
+bool files_save(const Files* files, FILE* f) {
+    uint64_t counts[5] = { files->count, files->names_size, files->dir_count, files->dir_slot_capacity, files->slot_capacity };
+    uint64_t sizes[5];
+    files__sections(counts, sizes);
+    if (fwrite(FILES__MAGIC, 1, 8, f) != 8) return false;
+    if (fwrite(counts, sizeof(counts), 1, f) != 1) return false;
+    if (fwrite(&files->slot_used, sizeof(uint64_t), 1, f) != 1) return false;
+
+    const void* arrays[5] = { files->items, files->names, files->dirs, files->dir_slots, files->slots };
+    for (size_t i = 0; i < 5; i++) {
+        if (!files__write_padded(arrays[i], sizes[i], f)) return false;
+    }
+    return true;
+}
+
+size_t files_load(Files* files, const void* data, size_t size) {
+    const char* bytes = data;
+    uint64_t counts[5];
+    uint64_t slot_used;
+    size_t header_size = 8 + sizeof(counts) + sizeof(slot_used);
+    if (size < header_size || memcmp(bytes, FILES__MAGIC, 8) != 0) return 0;
+    memcpy(counts, bytes + 8, sizeof(counts));
+    memcpy(&slot_used, bytes + 8 + sizeof(counts), sizeof(slot_used));
+
+    // Every count is bounded before sizes are computed from it, so they cannot overflow
+    for (size_t i = 0; i < 5; i++) {
+        if (counts[i] > UINT32_MAX || counts[i] > size) return 0;
+    }
+    // Table capacities are powers of 2, or 0 for an empty Files
+    if ((counts[3] & (counts[3] - 1)) != 0 || (counts[4] & (counts[4] - 1)) != 0) return 0;
+    if ((counts[0] > 0 && counts[4] == 0) || (counts[2] > 0 && counts[3] == 0) || slot_used > counts[4]) return 0;
+
+    uint64_t sizes[5];
+    files__sections(counts, sizes);
+    size_t total = header_size;
+    for (size_t i = 0; i < 5; i++) total += (sizes[i] + 7) / 8 * 8;
+    if (size < total) return 0;
+
+    // Offsets are checked, so a damaged file is rejected instead of read out of bounds
+    const File* items = (const File*)(bytes + header_size);
+    const char* names = bytes + header_size + (sizes[0] + 7) / 8 * 8;
+    const uint32_t* dirs = (const uint32_t*)(names + (sizes[1] + 7) / 8 * 8);
+    if (counts[1] > 0 && names[counts[1] - 1] != 0) return 0;
+    for (size_t i = 0; i < counts[0]; i++) {
+        if (items[i].dir >= counts[2] || items[i].name >= counts[1]) return 0;
+    }
+    for (size_t i = 0; i < counts[2]; i++) {
+        if (dirs[i] >= counts[1]) return 0;
+    }
+    // Lookups stop at an empty slot, so a table without one would be probed forever
+    const uint32_t* dir_slots = dirs + (sizes[2] + 7) / 8 * 8 / sizeof(uint32_t);
+    size_t dir_slots_used = 0;
+    for (size_t i = 0; i < counts[3]; i++) {
+        if (dir_slots[i] != FILES__TOMBSTONE && dir_slots[i] > counts[2]) return 0;
+        if (dir_slots[i] != 0) dir_slots_used++;
+    }
+    if (counts[3] > 0 && dir_slots_used >= counts[3]) return 0;
+    const uint32_t* slots = dir_slots + (sizes[3] + 7) / 8 * 8 / sizeof(uint32_t);
+    size_t slots_used = 0;
+    for (size_t i = 0; i < counts[4]; i++) {
+        if (slots[i] != FILES__TOMBSTONE && slots[i] > counts[0]) return 0;
+        if (slots[i] != 0) slots_used++;
+    }
+    if (slots_used != slot_used || (counts[4] > 0 && slots_used >= counts[4])) return 0;
+
+    files_free(files);
+    void* arrays[5];
+    size_t offset = header_size;
+    for (size_t i = 0; i < 5; i++) {
+        // At least one byte, so an empty array is not mistaken for a failed allocation
+        arrays[i] = malloc(sizes[i] > 0 ? sizes[i] : 1);
+        assert(arrays[i]);
+        memcpy(arrays[i], bytes + offset, sizes[i]);
+        offset += (sizes[i] + 7) / 8 * 8;
+    }
+
+    files->items = arrays[0];
+    files->count = files->capacity = counts[0];
+    files->names = arrays[1];
+    files->names_size = files->names_capacity = counts[1];
+    files->dirs = arrays[2];
+    files->dir_count = files->dir_capacity = counts[2];
+    files->dir_slots = arrays[3];
+    files->dir_slot_capacity = counts[3];
+    files->slots = arrays[4];
+    files->slot_capacity = counts[4];
+    files->slot_used = slot_used;
+    return total;
 }
 
 void files_list_null(Files* files, ...) {
@@ -450,10 +1092,7 @@ void files_list_null(Files* files, ...) {
 
     const char* filepath = va_arg(args, const char*);
     for (; filepath != NULL; filepath = va_arg(args, const char*)) {
-        File file = {0};
-        memcpy(file.value, filepath, strlen(filepath) + 1);
-
-        files_append(files, file);
+        files_append(files, filepath);
     }
 
     va_end(args);
@@ -493,12 +1132,11 @@ dir_while:while (dir_count > 0) {
                 if (dot != NULL && strcmp(dot, ext) != 0) continue;
             }
 
-            File file = {0};
+            char path[4096];
             #pragma GCC diagnostic ignored "-Wformat-truncation=0"
-            #pragma GCC diagnostic ignored "-Wstringop-overflow"
-            snprintf(file.value, 4096, "%s/%s", dirpath, ent->d_name);
+            snprintf(path, sizeof(path), "%s/%s", dirpath, ent->d_name);
 
-            files_append(files, file);
+            files_append(files, path);
         }
 
         closedir(dir);
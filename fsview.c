@@ -4,65 +4,1432 @@
 #define CBUILD_IMPLEMENTATION
 #include "cbuild.h"
 
-bool read_dir_files(Files* files, const char* path) {
+#include <pthread.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#define SCAN_MAX_WORKERS 8
+#define SCAN_BATCH_SIZE (64 * 1024)
+// A batch that is not full is still handed to the UI after this long, so the first entries show up right away
+#define SCAN_BATCH_MAX_AGE_NS 10000000ull
+// Time the frame loop spends moving scanned entries into files each frame
+#define SCAN_INGEST_BUDGET_NS 4000000ull
+// Indices the tree remembers as changed for the filter, past this it has to look at all of them
+#define TREE_DIRTY_MAX (64 * 1024)
+#define WATCH_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MODIFY | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK)
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// The files shown in the table, kept up to date by the scan and by inotify events
+typedef struct {
+    Files files;
+    // Paths deleted while a scan was running, so the entries it found before are not added back
+    Files removed;
+    size_t changes;
+    // Indices whose file was replaced since the filter last looked, or all of them. Removing
+    // moves the last file into the gap. Appended files are not listed, they come after the rest.
+    size_t* dirty;
+    size_t dirty_count;
+    size_t dirty_capacity;
+    bool all_dirty;
+}Tree;
+
+static void tree_free(Tree* tree) {
+    files_free(&tree->files);
+    files_free(&tree->removed);
+    free(tree->dirty);
+}
+
+static void tree_mark_dirty(Tree* tree, size_t i) {
+    if (tree->all_dirty) return;
+    if (tree->dirty_count >= TREE_DIRTY_MAX) {
+        tree->all_dirty = true;
+        tree->dirty_count = 0;
+        return;
+    }
+    if (tree->dirty_count >= tree->dirty_capacity) {
+        tree->dirty_capacity = tree->dirty_capacity == 0 ? 256 : tree->dirty_capacity * 2;
+        tree->dirty = realloc(tree->dirty, tree->dirty_capacity * sizeof(*tree->dirty));
+        assert(tree->dirty != NULL);
+    }
+    tree->dirty[tree->dirty_count++] = i;
+}
+
+static void tree_remove_at(Tree* tree, size_t i) {
+    files_remove_at(&tree->files, i);
+    tree_mark_dirty(tree, i);
+    // The next file appended takes the place of the last one
+    if (i != tree->files.count) tree_mark_dirty(tree, tree->files.count);
+}
+
+static bool tree_remove(Tree* tree, const char* path) {
+    size_t i = files_find(&tree->files, path);
+    if (i == FILES_NOT_FOUND) return false;
+    tree_remove_at(tree, i);
+    return true;
+}
+
+// Removes every file inside of the directories, which have no trailing '/', like files_remove_in_dirs
+static void tree_remove_in_dirs(Tree* tree, const char** dirs, size_t dir_count) {
+    Files* files = &tree->files;
+    if (dir_count == 0 || files->count == 0) return;
+
+    bool* removed = calloc(files->dir_count, sizeof(*removed));
+    assert(removed != NULL);
+    for (size_t dir = 0; dir < files->dir_count; dir++) {
+        const char* path = files->names + files->dirs[dir];
+        for (size_t i = 0; i < dir_count && !removed[dir]; i++) {
+            size_t len = strlen(dirs[i]);
+            removed[dir] = strncmp(path, dirs[i], len) == 0 && path[len] == '/';
+        }
+    }
+    for (size_t i = 0; i < files->count;) {
+        if (removed[files->items[i].dir]) {
+            tree_remove_at(tree, i);
+        } else {
+            i++;
+        }
+    }
+    free(removed);
+}
+
+// Whether path or one of its parent directories was deleted while scanning
+static bool tree_was_removed(Tree* tree, const char* path) {
+    if (tree->removed.count == 0) return false;
+    char buffer[PATH_MAX];
+    size_t len = strlen(path);
+    if (len >= sizeof(buffer)) return false;
+    memcpy(buffer, path, len + 1);
+    for (; len > 0; len--) {
+        if (buffer[len] != '/' && buffer[len] != 0) continue;
+        buffer[len] = 0;
+        if (files_find(&tree->removed, buffer) != FILES_NOT_FOUND) return true;
+    }
+    return false;
+}
+
+// Removes the files right inside of dir that no longer exist, or everything inside of it if it was deleted
+static void tree_prune_dir(Tree* tree, const char* dir, bool deleted) {
+    if (deleted) tree_remove_in_dirs(tree, &dir, 1);
+    size_t found = files_find_dir(&tree->files, dir);
+    if (found != FILES_NOT_FOUND) {
+        char path[PATH_MAX];
+        struct stat st;
+        for (size_t i = 0; i < tree->files.count;) {
+            if (tree->files.items[i].dir == found && (deleted || (files_path(&tree->files, i, path, sizeof(path)) < sizeof(path) && lstat(path, &st) != 0 && errno == ENOENT))) {
+                tree_remove_at(tree, i);
+            } else {
+                i++;
+            }
+        }
+    }
+    tree->changes++;
+}
+
+// Whether path is inside of one of the directories
+static bool path_in_dirs(const char* path, char** dirs, size_t dir_count) {
+    for (size_t i = 0; i < dir_count; i++) {
+        size_t len = strlen(dirs[i]);
+        if (strncmp(path, dirs[i], len) == 0 && path[len] == '/') return true;
+    }
+    return false;
+}
+
+typedef struct {
+    char* path;
+    struct timespec mtime;
+}WatchDir;
+
+// inotify watches on the scanned directories. Scan workers add watches, the frame loop applies the events.
+typedef struct {
+    int fd;
+    pthread_mutex_t lock;
+    // Indexed by watch descriptor
+    WatchDir* dirs;
+    size_t dir_capacity;
+    bool limit_reached;
+
+    // Wakes the frame loop up from waiting for input when events arrive
+    pthread_t waker;
+    bool waker_running;
+    atomic_bool stopping;
+}Watcher;
+
+// Kinds of the entries of a ScanBatch
+typedef enum {
+    // A file was found
+    SCAN_FILE,
+    // The directory changed since the cache was written, its files that are gone are removed
+    SCAN_PRUNE_DIR,
+    // The directory in the cache was deleted
+    SCAN_REMOVE_DIR,
+}ScanEntry;
+
+// Entries found by a scan worker, each a ScanEntry byte followed by a path terminated with 0
+typedef struct ScanBatch {
+    struct ScanBatch* next;
+    size_t count;
+    size_t size;
+    char data[SCAN_BATCH_SIZE];
+}ScanBatch;
+
+typedef struct {
+    char* path;
+    // A directory from the cache, only read if its mtime changed
+    bool validate;
+    struct timespec mtime;
+}ScanDir;
+
+// Walks directories on background threads. Workers share a stack of directories to read and
+// hand the paths they find to the UI through a lock free stack of batches.
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    ScanDir* dirs;
+    size_t dir_count;
+    size_t dir_capacity;
+    // Workers that may still push more paths
+    size_t busy;
+    bool stopping;
+    Watcher* watcher;
+
+    _Atomic(ScanBatch*) batches;
+    atomic_size_t dirs_scanned;
+
+    // Every directory that was read and its mtime at the time, written to the cache. Deleted
+    // directories stay with a negative tv_nsec, so there is nothing to keep in sync with the indices.
+    Files dirs_read;
+    struct timespec* dir_mtimes;
+    size_t dir_mtime_capacity;
+
+    pthread_t workers[SCAN_MAX_WORKERS];
+    size_t worker_count;
+
+    // Batches taken by the UI, oldest first, and the next path to ingest in the first one
+    ScanBatch* pending;
+    size_t pending_offset;
+    size_t pending_index;
+}Scanner;
+
+// raylib runs on GLFW, which can wake up an event wait from any thread. Not every build exposes it.
+extern void glfwPostEmptyEvent(void) __attribute__((weak));
+
+static void* watcher_waker(void* arg) {
+    Watcher* watcher = arg;
+    while (!atomic_load(&watcher->stopping)) {
+        struct pollfd pfd = { .fd = watcher->fd, .events = POLLIN };
+        if (poll(&pfd, 1, 100) <= 0) continue;
+        glfwPostEmptyEvent();
+        // The frame loop reads the events in the meantime
+        struct timespec wait = { 0, 10000000 };
+        nanosleep(&wait, NULL);
+    }
+    return NULL;
+}
+
+// Without inotify the tree is only scanned once
+static void watcher_init(Watcher* watcher) {
+    pthread_mutex_init(&watcher->lock, NULL);
+    watcher->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watcher->fd < 0) {
+        fprintf(stderr, "Failed to start watching for changes: %s\n", strerror(errno));
+        return;
+    }
+    if (glfwPostEmptyEvent != NULL) {
+        watcher->waker_running = pthread_create(&watcher->waker, NULL, watcher_waker, watcher) == 0;
+    }
+}
+
+static void watcher_free(Watcher* watcher) {
+    if (watcher->waker_running) {
+        atomic_store(&watcher->stopping, true);
+        pthread_join(watcher->waker, NULL);
+    }
+    if (watcher->fd >= 0) close(watcher->fd);
+    for (size_t i = 0; i < watcher->dir_capacity; i++) free(watcher->dirs[i].path);
+    free(watcher->dirs);
+    pthread_mutex_destroy(&watcher->lock);
+}
+
+// Watches a directory before it is read, so no change after the read is missed
+static void watcher_add(Watcher* watcher, const char* path, struct timespec mtime) {
+    if (watcher->fd < 0) return;
+
+    int wd = inotify_add_watch(watcher->fd, path, WATCH_MASK);
+    pthread_mutex_lock(&watcher->lock);
+    if (wd < 0) {
+        if (errno == ENOSPC && !watcher->limit_reached) {
+            fprintf(stderr, "Reached the inotify watch limit, changes in some directories are not shown (see fs.inotify.max_user_watches)\n");
+            watcher->limit_reached = true;
+        }
+    } else {
+        if ((size_t)wd >= watcher->dir_capacity) {
+            size_t capacity = watcher->dir_capacity == 0 ? 64 : watcher->dir_capacity;
+            while (capacity <= (size_t)wd) capacity *= 2;
+            watcher->dirs = realloc(watcher->dirs, capacity * sizeof(*watcher->dirs));
+            assert(watcher->dirs != NULL);
+            memset(watcher->dirs + watcher->dir_capacity, 0, (capacity - watcher->dir_capacity) * sizeof(*watcher->dirs));
+            watcher->dir_capacity = capacity;
+        }
+        free(watcher->dirs[wd].path);
+        watcher->dirs[wd].path = strdup(path);
+        watcher->dirs[wd].mtime = mtime;
+    }
+    pthread_mutex_unlock(&watcher->lock);
+}
+
+// Stops watching the directories inside of dir, and dir itself
+static void watcher_remove_dir(Watcher* watcher, const char* dir) {
+    if (watcher->fd < 0) return;
+    size_t len = strlen(dir);
+    pthread_mutex_lock(&watcher->lock);
+    for (size_t wd = 0; wd < watcher->dir_capacity; wd++) {
+        char* path = watcher->dirs[wd].path;
+        if (path == NULL || strncmp(path, dir, len) != 0 || (path[len] != '/' && path[len] != 0)) continue;
+        inotify_rm_watch(watcher->fd, wd);
+        free(path);
+        watcher->dirs[wd].path = NULL;
+    }
+    pthread_mutex_unlock(&watcher->lock);
+}
+
+static void watcher_rename_dir(Watcher* watcher, const char* from, const char* to) {
+    size_t from_len = strlen(from);
+    pthread_mutex_lock(&watcher->lock);
+    for (size_t wd = 0; wd < watcher->dir_capacity; wd++) {
+        char* path = watcher->dirs[wd].path;
+        if (path == NULL || strncmp(path, from, from_len) != 0 || (path[from_len] != '/' && path[from_len] != 0)) continue;
+        char* renamed = malloc(strlen(to) + strlen(path + from_len) + 1);
+        assert(renamed != NULL);
+        strcpy(renamed, to);
+        strcat(renamed, path + from_len);
+        free(path);
+        watcher->dirs[wd].path = renamed;
+    }
+    pthread_mutex_unlock(&watcher->lock);
+}
+
+static int compare_paths(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+// Directories whose mtime is not the one seen when they were read, without the ones inside of another.
+// Their entries changed since, in events that were lost.
+static size_t watcher_changed_dirs(Watcher* watcher, char*** changed) {
+    size_t count = 0;
+    size_t capacity = 0;
+    *changed = NULL;
+
+    pthread_mutex_lock(&watcher->lock);
+    for (size_t wd = 0; wd < watcher->dir_capacity; wd++) {
+        WatchDir* dir = &watcher->dirs[wd];
+        if (dir->path == NULL) continue;
+        struct stat st;
+        if (stat(dir->path, &st) == 0 && st.st_mtim.tv_sec == dir->mtime.tv_sec && st.st_mtim.tv_nsec == dir->mtime.tv_nsec) continue;
+
+        if (count >= capacity) {
+            capacity = capacity == 0 ? 64 : capacity * 2;
+            *changed = realloc(*changed, capacity * sizeof(**changed));
+            assert(*changed != NULL);
+        }
+        (*changed)[count++] = strdup(dir->path);
+    }
+    pthread_mutex_unlock(&watcher->lock);
+
+    // Sorted, a directory comes right before the ones inside of it
+    qsort(*changed, count, sizeof(**changed), compare_paths);
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (kept > 0 && path_in_dirs((*changed)[i], &(*changed)[kept - 1], 1)) {
+            free((*changed)[i]);
+        } else {
+            (*changed)[kept++] = (*changed)[i];
+        }
+    }
+    return kept;
+}
+
+static void scanner_push_batch(Scanner* scanner, ScanBatch* batch) {
+    ScanBatch* head = atomic_load_explicit(&scanner->batches, memory_order_relaxed);
+    do {
+        batch->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&scanner->batches, &head, batch, memory_order_release, memory_order_relaxed));
+}
+
+// Must be called with the lock held
+static void scanner_push_dir(Scanner* scanner, const char* path, bool validate, struct timespec mtime) {
+    if (scanner->dir_count >= scanner->dir_capacity) {
+        scanner->dir_capacity = scanner->dir_capacity == 0 ? 64 : scanner->dir_capacity * 2;
+        scanner->dirs = realloc(scanner->dirs, scanner->dir_capacity * sizeof(*scanner->dirs));
+        assert(scanner->dirs != NULL);
+    }
+    scanner->dirs[scanner->dir_count++] = (ScanDir) { strdup(path), validate, mtime };
+}
+
+// Scans the tree at path, which is already absolute
+static void scanner_add_dir(Scanner* scanner, const char* path) {
+    pthread_mutex_lock(&scanner->lock);
+    if (!scanner->stopping) {
+        scanner_push_dir(scanner, path, false, (struct timespec) {0});
+        pthread_cond_signal(&scanner->cond);
+    }
+    pthread_mutex_unlock(&scanner->lock);
+}
+
+// Must be called with the lock held
+static void scanner_record_dir(Scanner* scanner, const char* path, struct timespec mtime) {
+    size_t index = files_find(&scanner->dirs_read, path);
+    if (index == FILES_NOT_FOUND) {
+        index = scanner->dirs_read.count;
+        files_append(&scanner->dirs_read, path);
+        if (index >= scanner->dir_mtime_capacity) {
+            scanner->dir_mtime_capacity = scanner->dirs_read.capacity;
+            scanner->dir_mtimes = realloc(scanner->dir_mtimes, scanner->dir_mtime_capacity * sizeof(*scanner->dir_mtimes));
+            assert(scanner->dir_mtimes != NULL);
+        }
+    }
+    scanner->dir_mtimes[index] = mtime;
+}
+
+// Marks dir and the directories inside of it as deleted
+static void scanner_forget_dir(Scanner* scanner, const char* dir) {
+    size_t len = strlen(dir);
+    char path[PATH_MAX];
+    pthread_mutex_lock(&scanner->lock);
+    for (size_t i = 0; i < scanner->dirs_read.count; i++) {
+        files_path(&scanner->dirs_read, i, path, sizeof(path));
+        if (strncmp(path, dir, len) == 0 && (path[len] == '/' || path[len] == 0)) scanner->dir_mtimes[i].tv_nsec = -1;
+    }
+    pthread_mutex_unlock(&scanner->lock);
+}
+
+// Moves the directories inside of from to to, they are not read again
+static void scanner_rename_dir(Scanner* scanner, const char* from, const char* to) {
+    size_t from_len = strlen(from);
+    char path[PATH_MAX];
+    char renamed[PATH_MAX];
+    pthread_mutex_lock(&scanner->lock);
+    size_t count = scanner->dirs_read.count;
+    for (size_t i = 0; i < count; i++) {
+        files_path(&scanner->dirs_read, i, path, sizeof(path));
+        if (strncmp(path, from, from_len) != 0 || (path[from_len] != '/' && path[from_len] != 0)) continue;
+        if (scanner->dir_mtimes[i].tv_nsec < 0) continue;
+        if ((size_t)snprintf(renamed, sizeof(renamed), "%s%s", to, path + from_len) >= sizeof(renamed)) continue;
+        scanner_record_dir(scanner, renamed, scanner->dir_mtimes[i]);
+        scanner->dir_mtimes[i].tv_nsec = -1;
+    }
+    pthread_mutex_unlock(&scanner->lock);
+}
+
+// Whether path was read or is in the cache, and was not deleted since
+static bool scanner_knows_dir(Scanner* scanner, const char* path) {
+    pthread_mutex_lock(&scanner->lock);
+    size_t index = files_find(&scanner->dirs_read, path);
+    bool known = index != FILES_NOT_FOUND && scanner->dir_mtimes[index].tv_nsec >= 0;
+    pthread_mutex_unlock(&scanner->lock);
+    return known;
+}
+
+// Adds an entry to the worker's batch, handing the batch over when it is full
+static ScanBatch* scanner_add_path(Scanner* scanner, ScanBatch* batch, ScanEntry entry, const char* path, uint64_t* batch_start) {
+    size_t size = strlen(path) + 2;
+    if (batch != NULL && batch->size + size > SCAN_BATCH_SIZE) {
+        scanner_push_batch(scanner, batch);
+        batch = NULL;
+    }
+    if (batch == NULL) {
+        batch = malloc(sizeof(*batch));
+        assert(batch != NULL);
+        batch->count = 0;
+        batch->size = 0;
+        *batch_start = now_ns();
+    }
+    batch->data[batch->size] = entry;
+    memcpy(batch->data + batch->size + 1, path, size - 1);
+    batch->size += size;
+    batch->count++;
+    return batch;
+}
+
+// Reads one directory, adding its files to batch and its subdirectories to the shared stack. A
+// directory from the cache is only read if it changed, and its subdirectories in the cache are
+// validated on their own.
+static ScanBatch* scanner_read_dir(Scanner* scanner, const ScanDir* scan_dir, ScanBatch* batch, uint64_t* batch_start) {
+    const char* path = scan_dir->path;
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        if (scan_dir->validate) {
+            pthread_mutex_lock(&scanner->lock);
+            scanner_record_dir(scanner, path, (struct timespec) { 0, -1 });
+            pthread_mutex_unlock(&scanner->lock);
+            return scanner_add_path(scanner, batch, SCAN_REMOVE_DIR, path, batch_start);
+        }
+        // Deleted since it was found
+        if (errno != ENOENT) fprintf(stderr, "Failed to open directory: %s\n", path);
+        return batch;
+    }
+
+    watcher_add(scanner->watcher, path, st.st_mtim);
+    pthread_mutex_lock(&scanner->lock);
+    scanner_record_dir(scanner, path, st.st_mtim);
+    pthread_mutex_unlock(&scanner->lock);
+    if (scan_dir->validate) {
+        // Entries right inside of it were neither added nor removed
+        if (st.st_mtim.tv_sec == scan_dir->mtime.tv_sec && st.st_mtim.tv_nsec == scan_dir->mtime.tv_nsec) return batch;
+        batch = scanner_add_path(scanner, batch, SCAN_PRUNE_DIR, path, batch_start);
+    }
+
     DIR* dir = opendir(path);
     if (dir == NULL) {
-        fprintf(stderr, "Failed to open directory: %s\n", path);
-        return false;
+        // Deleted since it was found
+        if (errno != ENOENT) fprintf(stderr, "Failed to open directory: %s\n", path);
+        return batch;
     }
 
-    char path_buffer[4096] = {0};
-    realpath(path, path_buffer);
-
-    struct dirent* ent = NULL;
-    for (ent = readdir(dir); ent != NULL; ent = readdir(dir)) {
-        int n = strlen(path_buffer);
-        sprintf(path_buffer, "%s/%s", path_buffer, ent->d_name);
+    char path_buffer[PATH_MAX];
+    for (struct dirent* ent = readdir(dir); ent != NULL; ent = readdir(dir)) {
         if (ent->d_name[0] == '.') continue;
-        if (ent->d_type == 4) {
-            if (!read_dir_files(files, path_buffer)) return false;
+        int n = snprintf(path_buffer, sizeof(path_buffer), "%s/%s", path, ent->d_name);
+        if (n < 0 || (size_t)n >= sizeof(path_buffer)) continue;
+
+        bool is_dir = ent->d_type == DT_DIR;
+        if (ent->d_type == DT_UNKNOWN) {
+            struct stat st;
+            is_dir = lstat(path_buffer, &st) == 0 && S_ISDIR(st.st_mode);
+        }
+
+        if (is_dir) {
+            if (!scan_dir->validate || !scanner_knows_dir(scanner, path_buffer)) scanner_add_dir(scanner, path_buffer);
         } else {
-            File file = {0};
-            strcpy(file.value, path_buffer);
-            files_append(files, file);
+            batch = scanner_add_path(scanner, batch, SCAN_FILE, path_buffer, batch_start);
         }
-        path_buffer[n] = 0;
     }
 
     closedir(dir);
+    return batch;
+}
+
+// Workers wait for more directories until the scanner is stopped
+static void* scanner_worker(void* arg) {
+    Scanner* scanner = arg;
+    ScanBatch* batch = NULL;
+    uint64_t batch_start = 0;
+    bool busy = false;
+
+    pthread_mutex_lock(&scanner->lock);
+    while (!scanner->stopping) {
+        if (scanner->dir_count == 0) {
+            if (batch != NULL) {
+                // Handed over before going idle, while the worker still counts as busy
+                pthread_mutex_unlock(&scanner->lock);
+                scanner_push_batch(scanner, batch);
+                batch = NULL;
+                pthread_mutex_lock(&scanner->lock);
+                continue;
+            }
+            if (busy) {
+                scanner->busy--;
+                busy = false;
+            }
+            pthread_cond_wait(&scanner->cond, &scanner->lock);
+            continue;
+        }
+
+        ScanDir scan_dir = scanner->dirs[--scanner->dir_count];
+        if (!busy) {
+            scanner->busy++;
+            busy = true;
+        }
+        pthread_mutex_unlock(&scanner->lock);
+
+        batch = scanner_read_dir(scanner, &scan_dir, batch, &batch_start);
+        free(scan_dir.path);
+        atomic_fetch_add_explicit(&scanner->dirs_scanned, 1, memory_order_relaxed);
+        if (batch != NULL && now_ns() - batch_start >= SCAN_BATCH_MAX_AGE_NS) {
+            scanner_push_batch(scanner, batch);
+            batch = NULL;
+        }
+
+        pthread_mutex_lock(&scanner->lock);
+    }
+    pthread_mutex_unlock(&scanner->lock);
+
+    free(batch);
+    return NULL;
+}
+
+// Starts walking the tree at root, an absolute path. With the directories of a cache, and their
+// mtimes, only the directories that changed since are read.
+static bool scanner_start(Scanner* scanner, Watcher* watcher, const char* root, Files* cached_dirs, struct timespec* cached_mtimes) {
+    pthread_mutex_init(&scanner->lock, NULL);
+    pthread_cond_init(&scanner->cond, NULL);
+    scanner->watcher = watcher;
+    if (cached_dirs != NULL) {
+        scanner->dirs_read = *cached_dirs;
+        scanner->dir_mtimes = cached_mtimes;
+        scanner->dir_mtime_capacity = cached_dirs->count;
+        char path[PATH_MAX];
+        for (size_t i = 0; i < cached_dirs->count; i++) {
+            files_path(cached_dirs, i, path, sizeof(path));
+            if (cached_mtimes[i].tv_nsec >= 0) scanner_push_dir(scanner, path, true, cached_mtimes[i]);
+        }
+    }
+    if (scanner->dir_count == 0) scanner_push_dir(scanner, root, false, (struct timespec) {0});
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t worker_count = cpus < 1 ? 1 : cpus > SCAN_MAX_WORKERS ? SCAN_MAX_WORKERS : (size_t)cpus;
+    for (size_t i = 0; i < worker_count; i++) {
+        if (pthread_create(&scanner->workers[scanner->worker_count], NULL, scanner_worker, scanner) == 0) {
+            scanner->worker_count++;
+        }
+    }
+    if (scanner->worker_count == 0) {
+        fprintf(stderr, "Failed to start the scan of: %s\n", root);
+        return false;
+    }
     return true;
 }
 
-int main(void) {
+// Whether every directory has been read and every path found ingested
+static bool scanner_done(Scanner* scanner) {
+    pthread_mutex_lock(&scanner->lock);
+    bool idle = scanner->busy == 0 && scanner->dir_count == 0;
+    pthread_mutex_unlock(&scanner->lock);
+    return idle && atomic_load_explicit(&scanner->batches, memory_order_acquire) == NULL && scanner->pending == NULL;
+}
+
+// Moves scanned paths into the tree until budget_ns runs out
+static void scanner_ingest(Scanner* scanner, Tree* tree, uint64_t budget_ns) {
+    uint64_t start = now_ns();
+    for (;;) {
+        if (scanner->pending == NULL) {
+            // The stack has the newest batch on top, reversed to keep the order of the walk
+            ScanBatch* batch = atomic_exchange_explicit(&scanner->batches, NULL, memory_order_acquire);
+            while (batch != NULL) {
+                ScanBatch* next = batch->next;
+                batch->next = scanner->pending;
+                scanner->pending = batch;
+                batch = next;
+            }
+            scanner->pending_offset = 0;
+            scanner->pending_index = 0;
+            if (scanner->pending == NULL) return;
+        }
+
+        ScanBatch* batch = scanner->pending;
+        files_maybe_resize(&tree->files, batch->count - scanner->pending_index);
+        while (scanner->pending_index < batch->count) {
+            ScanEntry entry = batch->data[scanner->pending_offset];
+            const char* path = batch->data + scanner->pending_offset + 1;
+            if (entry == SCAN_FILE) {
+                if (!tree_was_removed(tree, path)) files_add(&tree->files, path);
+            } else {
+                tree_prune_dir(tree, path, entry == SCAN_REMOVE_DIR);
+            }
+            scanner->pending_offset += strlen(path) + 2;
+            scanner->pending_index++;
+            if (scanner->pending_index % 1024 == 0 && now_ns() - start >= budget_ns) return;
+        }
+
+        scanner->pending = batch->next;
+        scanner->pending_offset = 0;
+        scanner->pending_index = 0;
+        free(batch);
+        if (now_ns() - start >= budget_ns) return;
+    }
+}
+
+static void scanner_stop(Scanner* scanner) {
+    if (scanner->worker_count == 0) return;
+
+    // Workers exit once their current directory is done
+    pthread_mutex_lock(&scanner->lock);
+    scanner->stopping = true;
+    pthread_cond_broadcast(&scanner->cond);
+    pthread_mutex_unlock(&scanner->lock);
+    for (size_t i = 0; i < scanner->worker_count; i++) pthread_join(scanner->workers[i], NULL);
+
+    ScanBatch* batch = atomic_exchange(&scanner->batches, NULL);
+    while (batch != NULL) {
+        ScanBatch* next = batch->next;
+        free(batch);
+        batch = next;
+    }
+    while (scanner->pending != NULL) {
+        ScanBatch* next = scanner->pending->next;
+        free(scanner->pending);
+        scanner->pending = next;
+    }
+    for (size_t i = 0; i < scanner->dir_count; i++) free(scanner->dirs[i].path);
+    free(scanner->dirs);
+    files_free(&scanner->dirs_read);
+    free(scanner->dir_mtimes);
+    pthread_cond_destroy(&scanner->cond);
+    pthread_mutex_destroy(&scanner->lock);
+}
+
+// Directories deleted or moved away in the events read so far. Their files are removed in one pass.
+typedef struct {
+    char** items;
+    size_t count;
+    size_t capacity;
+}DirList;
+
+static void dir_list_push(DirList* list, const char* path) {
+    if (list->count >= list->capacity) {
+        list->capacity = list->capacity == 0 ? 16 : list->capacity * 2;
+        list->items = realloc(list->items, list->capacity * sizeof(*list->items));
+        assert(list->items != NULL);
+    }
+    list->items[list->count++] = strdup(path);
+}
+
+static void dir_list_flush(DirList* list, Tree* tree) {
+    tree_remove_in_dirs(tree, (const char**)list->items, list->count);
+    for (size_t i = 0; i < list->count; i++) free(list->items[i]);
+    list->count = 0;
+}
+
+static void apply_dir_removed(Watcher* watcher, Scanner* scanner, Tree* tree, DirList* removed, const char* path, bool scanning) {
+    watcher_remove_dir(watcher, path);
+    scanner_forget_dir(scanner, path);
+    dir_list_push(removed, path);
+    if (scanning) files_add(&tree->removed, path);
+    tree->changes++;
+}
+
+// Applies the inotify events that arrived since the last frame to the tree. Directories that
+// appear are scanned, and after an overflow of the event queue the directories that changed.
+static void watcher_apply(Watcher* watcher, Scanner* scanner, Tree* tree) {
+    if (watcher->fd < 0) return;
+
+    bool scanning = !scanner_done(scanner);
+    DirList removed = {0};
+    // A directory moved away, which is renamed in place if the next event moves it back into the tree
+    char moved_from[PATH_MAX] = {0};
+    uint32_t moved_cookie = 0;
+    bool overflow = false;
+
+    char buffer[64 * 1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+    for (;;) {
+        ssize_t n = read(watcher->fd, buffer, sizeof(buffer));
+        if (n <= 0) break;
+
+        for (char* at = buffer; at < buffer + n;) {
+            struct inotify_event* event = (struct inotify_event*)at;
+            at += sizeof(*event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                overflow = true;
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                pthread_mutex_lock(&watcher->lock);
+                if ((size_t)event->wd < watcher->dir_capacity) {
+                    free(watcher->dirs[event->wd].path);
+                    watcher->dirs[event->wd].path = NULL;
+                }
+                pthread_mutex_unlock(&watcher->lock);
+                continue;
+            }
+            if (event->len == 0 || event->name[0] == '.') continue;
+
+            char path[PATH_MAX] = {0};
+            pthread_mutex_lock(&watcher->lock);
+            if ((size_t)event->wd < watcher->dir_capacity && watcher->dirs[event->wd].path != NULL) {
+                snprintf(path, sizeof(path), "%s/%s", watcher->dirs[event->wd].path, event->name);
+            }
+            pthread_mutex_unlock(&watcher->lock);
+            if (path[0] == 0) continue;
+
+            if (moved_from[0] != 0 && !((event->mask & IN_MOVED_TO) && event->cookie == moved_cookie)) {
+                apply_dir_removed(watcher, scanner, tree, &removed, moved_from, scanning);
+                moved_from[0] = 0;
+            }
+
+            if (event->mask & IN_ISDIR) {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    // Removed before, so the new files in it are not removed again
+                    dir_list_flush(&removed, tree);
+                    files_remove(&tree->removed, path);
+                    if (moved_from[0] != 0 && !scanning) {
+                        files_rename_dir(&tree->files, moved_from, path);
+                        // Files of a directory that existed already may have been removed in between
+                        tree->all_dirty = true;
+                        watcher_rename_dir(watcher, moved_from, path);
+                        scanner_rename_dir(scanner, moved_from, path);
+                        tree->changes++;
+                    } else {
+                        if (moved_from[0] != 0) apply_dir_removed(watcher, scanner, tree, &removed, moved_from, scanning);
+                        dir_list_flush(&removed, tree);
+                        scanner_add_dir(scanner, path);
+                        tree->changes++;
+                    }
+                    moved_from[0] = 0;
+                } else if (event->mask & IN_MOVED_FROM) {
+                    strcpy(moved_from, path);
+                    moved_cookie = event->cookie;
+                } else if (event->mask & IN_DELETE) {
+                    apply_dir_removed(watcher, scanner, tree, &removed, path, scanning);
+                }
+            } else if (event->mask & (IN_CREATE | IN_MOVED_TO | IN_MODIFY)) {
+                // A modified file is added in case the event of its creation was lost
+                files_remove(&tree->removed, path);
+                if (files_add(&tree->files, path)) tree->changes++;
+            } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                if (scanning) files_add(&tree->removed, path);
+                if (tree_remove(tree, path)) tree->changes++;
+            }
+        }
+    }
+    if (moved_from[0] != 0) apply_dir_removed(watcher, scanner, tree, &removed, moved_from, scanning);
+    dir_list_flush(&removed, tree);
+
+    if (overflow) {
+        // Only the subtrees that changed are read again
+        char** changed = NULL;
+        size_t changed_count = watcher_changed_dirs(watcher, &changed);
+        tree_remove_in_dirs(tree, (const char**)changed, changed_count);
+        for (size_t i = 0; i < changed_count; i++) {
+            scanner_add_dir(scanner, changed[i]);
+            free(changed[i]);
+        }
+        free(changed);
+        tree->changes++;
+    }
+    free(removed.items);
+}
+
+#define CACHE_MAGIC "FSVIEWC1"
+
+// The cache of a tree lives in $XDG_CACHE_HOME/fsview, named after a hash of its root
+static bool cache_path(const char* root, char* buf, size_t size, bool create) {
+    char dir[PATH_MAX];
+    const char* cache_home = getenv("XDG_CACHE_HOME");
+    const char* home = getenv("HOME");
+    if (cache_home != NULL && cache_home[0] != 0) {
+        snprintf(dir, sizeof(dir), "%s", cache_home);
+    } else if (home != NULL) {
+        snprintf(dir, sizeof(dir), "%s/.cache", home);
+    } else {
+        return false;
+    }
+    if (create) mkdir(dir, 0755);
+    size_t len = strlen(dir);
+    snprintf(dir + len, sizeof(dir) - len, "/fsview");
+    if (create) mkdir(dir, 0755);
+
+    uint64_t hash = 14695981039346656037ull;
+    for (const char* c = root; *c != 0; c++) {
+        hash ^= (unsigned char)*c;
+        hash *= 1099511628211ull;
+    }
+    return (size_t)snprintf(buf, size, "%s/%016llx.cache", dir, (unsigned long long)hash) < size;
+}
+
+// Loads the tree at root and the directories that were read for it, with their mtimes, from the
+// cache. The file is mapped and the arrays copied out, without hashing a single path.
+static bool cache_load(const char* root, Tree* tree, Files* dirs, struct timespec** mtimes) {
+    char path[PATH_MAX];
+    if (!cache_path(root, path, sizeof(path), false)) return false;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 16) {
+        close(fd);
+        return false;
+    }
+    size_t size = st.st_size;
+    const char* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return false;
+
+    bool ok = false;
+    size_t at = 0;
+    uint64_t root_len;
+    memcpy(&root_len, data + 8, sizeof(root_len));
+    at = 16 + ((root_len + 7) & ~(uint64_t)7);
+    if (memcmp(data, CACHE_MAGIC, 8) != 0 || root_len != strlen(root) || at > size) goto defer;
+    if (memcmp(data + 16, root, root_len) != 0) goto defer;
+
+    size_t read = files_load(&tree->files, data + at, size - at);
+    if (read == 0) goto defer;
+    at += read;
+    read = files_load(dirs, data + at, size - at);
+    if (read == 0) goto defer;
+    at += read;
+    if (size - at < dirs->count * sizeof(**mtimes)) goto defer;
+
+    *mtimes = malloc((dirs->count + 1) * sizeof(**mtimes));
+    assert(*mtimes != NULL);
+    memcpy(*mtimes, data + at, dirs->count * sizeof(**mtimes));
+    ok = true;
+
+defer:
+    munmap((void*)data, size);
+    if (!ok) {
+        files_free(&tree->files);
+        files_free(dirs);
+        memset(&tree->files, 0, sizeof(tree->files));
+        memset(dirs, 0, sizeof(*dirs));
+    }
+    return ok;
+}
+
+// Writes the tree to the cache, through a temporary file so a crash leaves the old cache intact.
+// Only a finished scan is written, deleted directories are left out.
+static void cache_save(const char* root, const Tree* tree, Scanner* scanner) {
+    char path[PATH_MAX];
+    char tmp_path[PATH_MAX + 8];
+    if (!cache_path(root, path, sizeof(path), true)) return;
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    Files dirs = {0};
+    struct timespec* mtimes = NULL;
+    pthread_mutex_lock(&scanner->lock);
+    mtimes = malloc((scanner->dirs_read.count + 1) * sizeof(*mtimes));
+    assert(mtimes != NULL);
+    char dir[PATH_MAX];
+    for (size_t i = 0; i < scanner->dirs_read.count; i++) {
+        if (scanner->dir_mtimes[i].tv_nsec < 0) continue;
+        files_path(&scanner->dirs_read, i, dir, sizeof(dir));
+        mtimes[dirs.count] = scanner->dir_mtimes[i];
+        files_append(&dirs, dir);
+    }
+    pthread_mutex_unlock(&scanner->lock);
+
+    FILE* f = fopen(tmp_path, "wb");
+    if (f == NULL) {
+        fprintf(stderr, "Failed to write cache: %s\n", tmp_path);
+        goto defer;
+    }
+    uint64_t root_len = strlen(root);
+    char padding[8] = {0};
+    bool ok = fwrite(CACHE_MAGIC, 8, 1, f) == 1
+        && fwrite(&root_len, sizeof(root_len), 1, f) == 1
+        && fwrite(root, 1, root_len, f) == root_len
+        && fwrite(padding, 1, (8 - root_len % 8) % 8, f) == (8 - root_len % 8) % 8
+        && files_save(&tree->files, f)
+        && files_save(&dirs, f)
+        && fwrite(mtimes, sizeof(*mtimes), dirs.count, f) == dirs.count;
+    if (fclose(f) != 0) ok = false;
+    if (!ok || rename(tmp_path, path) != 0) {
+        fprintf(stderr, "Failed to write cache: %s\n", path);
+        unlink(tmp_path);
+    }
+
+defer:
+    files_free(&dirs);
+    free(mtimes);
+}
+
+#define FILTER_MAX_WORKERS 16
+#define FILTER_QUERY_MAX 256
+// Matches in the name rank above matches spread over the directory and the name
+#define FILTER_NAME_SCORE 512
+#define FILTER_SCORE_MAX 1023
+
+typedef struct {
+    uint32_t index;
+    uint32_t score;
+}FilterMatch;
+
+typedef struct {
+    FilterMatch* items;
+    size_t count;
+    size_t capacity;
+}FilterMatches;
+
+// Fuzzy filter of the files. A file matches if the query is in its path in order, ASCII case
+// insensitive. Each name has a 64 bit signature of the characters in it, so most files are
+// skipped without reading their name. The rest are scored on a pool of threads and ranked with a
+// counting sort of the scores. The frame loop does not wait for the pool, it shows the matches of
+// the last job until the next one is done, and leaves the files alone in between.
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t dirs_done;
+    pthread_t workers[FILTER_MAX_WORKERS];
+    size_t worker_count;
+    uint64_t job;
+    size_t dirs_finished;
+    size_t finished;
+    bool busy;
+    // Set when a job is done, until its matches are taken
+    bool done;
+    bool stopping;
+
+    // Input of the current job. The frame loop only touches it while the pool is not busy.
+    const Files* files;
+    char query[FILTER_QUERY_MAX];
+    size_t query_len;
+    uint64_t query_signature;
+    uint64_t start_ns;
+    // Signatures of the names, up to date for [0, signature_count)
+    uint64_t* signatures;
+    size_t signature_count;
+    size_t signature_capacity;
+    // Signature of each directory and how many query characters it matches from the start
+    uint64_t* dir_signatures;
+    uint16_t* dir_matched;
+    size_t dir_capacity;
+    // Found by each of the workers
+    FilterMatches found[FILTER_MAX_WORKERS];
+
+    // Ranked by the last worker to finish, and swapped with matches once the frame loop sees it
+    uint32_t* next_matches;
+    size_t next_match_count;
+    size_t next_match_capacity;
+    float next_ms;
+
+    uint32_t* matches;
+    size_t match_count;
+    size_t match_capacity;
+    float ms;
+
+    // What the last job was started for
+    bool valid;
+    char last_query[FILTER_QUERY_MAX];
+    size_t last_count;
+    size_t last_changes;
+}Filter;
+
+static char ascii_lower(char c) {
+    return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+static bool is_alnum(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+}
+
+static uint64_t char_signature(char c) {
+    c = ascii_lower(c);
+    if (c >= 'a' && c <= 'z') return 1ull << (c - 'a');
+    if (c >= '0' && c <= '9') return 1ull << (26 + c - '0');
+    return 1ull << (36 + (uint8_t)c % 28);
+}
+
+static uint64_t text_signature(const char* text) {
+    uint64_t signature = 0;
+    for (; *text != 0; text++) signature |= char_signature(*text);
+    return signature;
+}
+
+// Score of the query found in text in order, or -1. Characters at the start of a word and right
+// after the previous match score more.
+static int fuzzy_score(const char* query, size_t query_len, const char* text) {
+    int score = 0;
+    size_t matched = 0;
+    char prev = '/';
+    bool prev_matched = false;
+    for (const char* c = text; *c != 0 && matched < query_len; c++) {
+        if (ascii_lower(*c) == query[matched]) {
+            score++;
+            if (prev_matched) score += 4;
+            if (!is_alnum(prev) || (prev >= 'a' && prev <= 'z' && *c >= 'A' && *c <= 'Z')) score += 3;
+            matched++;
+            prev_matched = true;
+        } else {
+            prev_matched = false;
+        }
+        prev = *c;
+    }
+    return matched == query_len ? score : -1;
+}
+
+// Query characters text matches from the start, in order
+static size_t fuzzy_prefix(const char* query, size_t query_len, const char* text) {
+    size_t matched = 0;
+    for (const char* c = text; *c != 0 && matched < query_len; c++) {
+        if (ascii_lower(*c) == query[matched]) matched++;
+    }
+    return matched;
+}
+
+static void filter_range(Filter* filter, size_t slot, size_t begin, size_t end) {
+    const Files* files = filter->files;
+    FilterMatches* found = &filter->found[slot];
+    found->count = 0;
+    if (found->capacity < end - begin) {
+        found->capacity = end - begin;
+        found->items = realloc(found->items, found->capacity * sizeof(*found->items));
+        assert(found->items != NULL);
+    }
+
+    for (size_t i = begin; i < end; i++) {
+        const File* file = &files->items[i];
+        const char* name = files->names + file->name;
+        if (i >= filter->signature_count) filter->signatures[i] = text_signature(name);
+        if (((filter->signatures[i] | filter->dir_signatures[file->dir]) & filter->query_signature) != filter->query_signature) continue;
+
+        int score = fuzzy_score(filter->query, filter->query_len, name);
+        if (score >= 0) {
+            score = FILTER_NAME_SCORE + (score < FILTER_SCORE_MAX - FILTER_NAME_SCORE ? score : FILTER_SCORE_MAX - FILTER_NAME_SCORE);
+        } else {
+            // The directory matches the start of the query, the name has to match the rest
+            size_t matched = filter->dir_matched[file->dir];
+            if (matched < filter->query_len) {
+                score = fuzzy_score(filter->query + matched, filter->query_len - matched, name);
+                if (score < 0) continue;
+            }
+            // Only the directory matching scores the lowest
+            score = score < FILTER_NAME_SCORE - 1 ? score + 1 : FILTER_NAME_SCORE - 1;
+        }
+        found->items[found->count++] = (FilterMatch) { i, score };
+    }
+}
+
+static void filter_dir_range(Filter* filter, size_t begin, size_t end) {
+    const Files* files = filter->files;
+    for (size_t dir = begin; dir < end; dir++) {
+        const char* name = files->names + files->dirs[dir];
+        filter->dir_signatures[dir] = text_signature(name);
+        filter->dir_matched[dir] = fuzzy_prefix(filter->query, filter->query_len, name);
+    }
+}
+
+// Part of count done by slot
+static void filter_slot_range(Filter* filter, size_t slot, size_t count, size_t* begin, size_t* end) {
+    *begin = count * slot / filter->worker_count;
+    *end = count * (slot + 1) / filter->worker_count;
+}
+
+// Counting sort of what the workers found by score, from the highest. Files with the same score
+// stay in the order of the table.
+static void filter_rank(Filter* filter) {
+    size_t counts[FILTER_SCORE_MAX + 1] = {0};
+    size_t total = 0;
+    for (size_t slot = 0; slot < filter->worker_count; slot++) {
+        for (size_t i = 0; i < filter->found[slot].count; i++) counts[filter->found[slot].items[i].score]++;
+        total += filter->found[slot].count;
+    }
+    size_t offset = 0;
+    for (size_t score = FILTER_SCORE_MAX + 1; score-- > 0;) {
+        size_t count = counts[score];
+        counts[score] = offset;
+        offset += count;
+    }
+
+    if (filter->next_match_capacity < total) {
+        filter->next_match_capacity = total;
+        filter->next_matches = realloc(filter->next_matches, filter->next_match_capacity * sizeof(*filter->next_matches));
+        assert(filter->next_matches != NULL);
+    }
+    for (size_t slot = 0; slot < filter->worker_count; slot++) {
+        for (size_t i = 0; i < filter->found[slot].count; i++) {
+            FilterMatch match = filter->found[slot].items[i];
+            filter->next_matches[counts[match.score]++] = match.index;
+        }
+    }
+    filter->next_match_count = total;
+    filter->signature_count = filter->files->count;
+    filter->next_ms = (now_ns() - filter->start_ns) / 1e6f;
+}
+
+static void* filter_worker(void* arg) {
+    Filter* filter = arg;
+    size_t slot = 0;
+    uint64_t job = 0;
+
+    pthread_mutex_lock(&filter->lock);
+    for (size_t i = 0; i < filter->worker_count; i++) {
+        if (pthread_equal(filter->workers[i], pthread_self())) slot = i;
+    }
+    for (;;) {
+        while (filter->job == job && !filter->stopping) pthread_cond_wait(&filter->start, &filter->lock);
+        if (filter->stopping) break;
+        job = filter->job;
+        pthread_mutex_unlock(&filter->lock);
+
+        // The files of a directory can be in the range of any worker, so all of them are done first
+        size_t begin, end;
+        filter_slot_range(filter, slot, filter->files->dir_count, &begin, &end);
+        filter_dir_range(filter, begin, end);
+        pthread_mutex_lock(&filter->lock);
+        if (++filter->dirs_finished == filter->worker_count) pthread_cond_broadcast(&filter->dirs_done);
+        while (filter->dirs_finished < filter->worker_count) pthread_cond_wait(&filter->dirs_done, &filter->lock);
+        pthread_mutex_unlock(&filter->lock);
+
+        filter_slot_range(filter, slot, filter->files->count, &begin, &end);
+        filter_range(filter, slot, begin, end);
+
+        pthread_mutex_lock(&filter->lock);
+        if (++filter->finished == filter->worker_count) {
+            filter_rank(filter);
+            filter->busy = false;
+            filter->done = true;
+            // The frame loop may be waiting for input in idle mode
+            if (glfwPostEmptyEvent != NULL) glfwPostEmptyEvent();
+        }
+    }
+    pthread_mutex_unlock(&filter->lock);
+    return NULL;
+}
+
+static void filter_init(Filter* filter) {
+    pthread_mutex_init(&filter->lock, NULL);
+    pthread_cond_init(&filter->start, NULL);
+    pthread_cond_init(&filter->dirs_done, NULL);
+
+    // The frame loop keeps a core to itself, but there is always one worker so it never filters
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t worker_count = cpus <= 2 ? 1 : cpus - 1 > FILTER_MAX_WORKERS ? FILTER_MAX_WORKERS : (size_t)cpus - 1;
+    // Workers look up their slot under the lock, after all of them are created
+    pthread_mutex_lock(&filter->lock);
+    for (size_t i = 0; i < worker_count; i++) {
+        if (pthread_create(&filter->workers[filter->worker_count], NULL, filter_worker, filter) == 0) filter->worker_count++;
+    }
+    pthread_mutex_unlock(&filter->lock);
+    if (filter->worker_count == 0) {
+        fprintf(stderr, "Failed to start the filter threads\n");
+        exit(1);
+    }
+}
+
+static void filter_free(Filter* filter) {
+    pthread_mutex_lock(&filter->lock);
+    filter->stopping = true;
+    pthread_cond_broadcast(&filter->start);
+    pthread_mutex_unlock(&filter->lock);
+    for (size_t i = 0; i < filter->worker_count; i++) pthread_join(filter->workers[i], NULL);
+
+    free(filter->signatures);
+    free(filter->dir_signatures);
+    free(filter->dir_matched);
+    for (size_t i = 0; i < FILTER_MAX_WORKERS; i++) free(filter->found[i].items);
+    free(filter->next_matches);
+    free(filter->matches);
+    pthread_cond_destroy(&filter->dirs_done);
+    pthread_cond_destroy(&filter->start);
+    pthread_mutex_destroy(&filter->lock);
+}
+
+// Whether a job is running, in which case the files must not change. Takes the matches of a
+// job that is done.
+static bool filter_busy(Filter* filter) {
+    pthread_mutex_lock(&filter->lock);
+    bool busy = filter->busy;
+    bool done = filter->done;
+    filter->done = false;
+    pthread_mutex_unlock(&filter->lock);
+    if (!done) return busy;
+
+    uint32_t* matches = filter->matches;
+    size_t capacity = filter->match_capacity;
+    filter->matches = filter->next_matches;
+    filter->match_capacity = filter->next_match_capacity;
+    filter->match_count = filter->next_match_count;
+    filter->ms = filter->next_ms;
+    filter->next_matches = matches;
+    filter->next_match_capacity = capacity;
+    return busy;
+}
+
+// Starts filtering the files of the tree with query on the pool, unless nothing changed since
+// the last job or it is still running
+static void filter_update(Filter* filter, Tree* tree, const char* query) {
+    const Files* files = &tree->files;
+    if (filter->valid && strcmp(filter->last_query, query) == 0 && filter->last_count == files->count && filter->last_changes == tree->changes) return;
+    if (filter_busy(filter)) return;
+
+    // Only the names that were replaced get a new signature, appended ones get theirs in the job
+    if (filter->signature_capacity < files->count) {
+        filter->signature_capacity = files->capacity;
+        filter->signatures = realloc(filter->signatures, filter->signature_capacity * sizeof(*filter->signatures));
+        assert(filter->signatures != NULL);
+    }
+    if (filter->signature_count > files->count) filter->signature_count = files->count;
+    if (tree->all_dirty) filter->signature_count = 0;
+    for (size_t i = 0; i < tree->dirty_count; i++) {
+        size_t index = tree->dirty[i];
+        if (index < filter->signature_count) filter->signatures[index] = text_signature(files_name(files, index));
+    }
+    tree->dirty_count = 0;
+    tree->all_dirty = false;
+
+    filter->valid = true;
+    snprintf(filter->last_query, sizeof(filter->last_query), "%s", query);
+    filter->last_count = files->count;
+    filter->last_changes = tree->changes;
+
+    filter->files = files;
+    filter->start_ns = now_ns();
+    filter->query_len = 0;
+    filter->query_signature = 0;
+    for (const char* c = query; *c != 0 && filter->query_len < FILTER_QUERY_MAX; c++) {
+        if (*c == ' ') continue;
+        filter->query[filter->query_len++] = ascii_lower(*c);
+        filter->query_signature |= char_signature(*c);
+    }
+
+    if (filter->dir_capacity < files->dir_count) {
+        filter->dir_capacity = files->dir_capacity;
+        filter->dir_signatures = realloc(filter->dir_signatures, filter->dir_capacity * sizeof(*filter->dir_signatures));
+        filter->dir_matched = realloc(filter->dir_matched, filter->dir_capacity * sizeof(*filter->dir_matched));
+        assert(filter->dir_signatures != NULL && filter->dir_matched != NULL);
+    }
+
+    pthread_mutex_lock(&filter->lock);
+    filter->job++;
+    filter->dirs_finished = 0;
+    filter->finished = 0;
+    filter->busy = true;
+    pthread_cond_broadcast(&filter->start);
+    pthread_mutex_unlock(&filter->lock);
+}
+
+// Rows of the table, all files or the matches of the filter
+typedef struct {
+    const Files* files;
+    const uint32_t* rows;
+}FileView;
+
+// Names and directories are stored separately, so no cell is copied
+static const char* file_cell(void* user, size_t row, size_t column, char* buf, size_t buf_size) {
+    (void)buf;
+    (void)buf_size;
+    const FileView* view = user;
+    size_t index = view->rows != NULL ? view->rows[row] : row;
+    // Matches are a job behind the files, which may have lost some at the end since
+    if (index >= view->files->count) return NULL;
+    if (column == 1) return files_dir(view->files, index);
+    return files_name(view->files, index);
+}
+
+// The text of input as UTF-8, cut at buf_size
+static void input_text(InputBuffer* input, char* buf, size_t buf_size) {
+    const int* codepoints = yagi_input_buffer_codepoints(input);
+    size_t len = 0;
+    for (size_t i = 0; i < input->count; i++) {
+        int size = 0;
+        const char* bytes = CodepointToUTF8(codepoints[i], &size);
+        if (len + size >= buf_size) break;
+        memcpy(buf + len, bytes, size);
+        len += size;
+    }
+    buf[len] = 0;
+}
+
+int main(int argc, char* argv[]) {
     InitWindow(800, 450, "fsview - yagi example");
+    if (!yagi_ui_input_log_args(argc, argv)) return 1;
+    // Only redraw when something changes
+    yagi_ui_set_idle_mode(true);
 
-    Files files = {0};
+    // Optional TTF/OTF font for file names outside of ASCII, rasterized on demand
+    YagiFont* font = NULL;
+    const char* font_path = getenv("FSVIEW_FONT");
+    if (font_path != NULL) font = yagi_font_load(font_path);
+
+    char root[PATH_MAX];
+    DIR* root_dir = realpath(".", root) != NULL ? opendir(root) : NULL;
+    if (root_dir == NULL) {
+        fprintf(stderr, "Failed to open directory: .\n");
+        return 1;
+    }
+    closedir(root_dir);
 
-    if (!read_dir_files(&files, ".")) return 1;
+    // The tree is scanned in the background and shows up in the table as it is found. Afterwards
+    // inotify events keep it up to date. A tree that was scanned before shows up right away from
+    // the cache, and only the directories that changed since are read.
+    Tree tree = {0};
+    Files cached_dirs = {0};
+    struct timespec* cached_mtimes = NULL;
+    bool cached = cache_load(root, &tree, &cached_dirs, &cached_mtimes);
+    Watcher watcher = {0};
+    watcher_init(&watcher);
+    Scanner scanner = {0};
+    if (!scanner_start(&scanner, &watcher, root, cached ? &cached_dirs : NULL, cached_mtimes)) return 1;
 
-    Vector2 ui_start = (Vector2){10, 10};
-    while (!WindowShouldClose()) {
-        Vector2 wheel_delta = GetMouseWheelMoveV();
-        ui_start.y += wheel_delta.y * 50;
+    YagiTableColumn columns[] = {
+        { "name", 250 },
+        { "directory", 1000 },
+    };
+    YagiScroll scroll = {0};
+    InputBuffer filter_input = {0};
+    Filter filter = {0};
+    filter_init(&filter);
+    char query[FILTER_QUERY_MAX] = {0};
+    while (!WindowShouldClose() && !yagi_ui_replay_done()) {
+        // The filter reads the files while it runs, the changes wait for it in the meantime
+        bool filtering = filter_busy(&filter);
+        bool scanning = !scanner_done(&scanner);
+        if (!filtering) {
+            watcher_apply(&watcher, &scanner, &tree);
+            scanning = !scanner_done(&scanner);
+            if (scanning) {
+                scanner_ingest(&scanner, &tree, SCAN_INGEST_BUDGET_NS);
+            } else if (tree.removed.count > 0) {
+                files_clear(&tree.removed);
+            }
+        }
 
         BeginDrawing();
         ClearBackground(WHITE);
 
         yagi_ui_begin();
-        yagi_begin_layout(LAYOUT_VERT, ui_start, 10);
+        if (font != NULL) yagi_ui_get_style()->dynamic_font = font;
+        // Keeps drawing frames while entries are coming in
+        if (scanning) yagi_ui_request_frame();
+        // The screen size of the input, so a replayed session lays out the same
+        Vector2 screen = yagi_ui_input()->screen_size;
+        yagi_begin_layout(LAYOUT_VERT, ((Vector2){10, 10}), 10);
 
-        for (size_t i = 0; i < files.count; ++i) {
-            yagi_begin_sublayout(LAYOUT_HORZ, 10);
-            yagi_text("%s", files.items[i].value);
-            yagi_end_layout();
+        // Filtered in the background, the matches of the last query stay until the new ones are done
+        yagi_input(screen.x - 20, &filter_input);
+        char new_query[FILTER_QUERY_MAX];
+        input_text(&filter_input, new_query, sizeof(new_query));
+        if (strcmp(new_query, query) != 0) {
+            strcpy(query, new_query);
+            scroll.offset.y = 0;
+        }
+        FileView view = { .files = &tree.files };
+        size_t row_count = tree.files.count;
+        if (query[0] != 0) {
+            filter_update(&filter, &tree, query);
+            // Picks up the matches as soon as the job is done
+            if (filter_busy(&filter)) yagi_ui_request_frame();
+            view.rows = filter.matches;
+            row_count = filter.match_count;
         }
 
+        if (query[0] != 0) {
+            yagi_text("%zu of %zu files (%.1f ms)", filter.match_count, tree.files.count, filter.ms);
+        } else if (scanning) {
+            yagi_text("scanning: %zu files, %zu directories read", tree.files.count, atomic_load(&scanner.dirs_scanned));
+        } else {
+            yagi_text("%zu files, %zu changes", tree.files.count, tree.changes);
+        }
+        float table_height = screen.y - 40 - 2 * yagi_ui_get_style()->font_size;
+        YagiTable table = {
+            .columns = columns,
+            .column_count = sizeof(columns) / sizeof(columns[0]),
+            .row_count = row_count,
+            .cell = file_cell,
+            .user = &view,
+        };
+        yagi_table(((Vector2){screen.x - 20, table_height}), &table, &scroll);
         yagi_end_layout();
         yagi_ui_end();
 
         EndDrawing();
     }
 
+    filter_free(&filter);
+    yagi_input_buffer_free(&filter_input);
+    if (scanner_done(&scanner)) cache_save(root, &tree, &scanner);
+    scanner_stop(&scanner);
+    watcher_free(&watcher);
+    tree_free(&tree);
+    yagi_font_unload(font);
+    yagi_ui_close_input_log();
     CloseWindow();
     return 0;
 }
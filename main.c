@@ -12,14 +12,17 @@ typedef struct {
     size_t age;
 }Person;
 
-int main(void) {
+int main(int argc, char* argv[]) {
     InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "yagi");
+    if (!yagi_ui_input_log_args(argc, argv)) return 1;
+    // Only redraw when something changes
+    yagi_ui_set_idle_mode(true);
 
 #ifdef YAGI_DEBUG 
     SetTraceLogLevel(LOG_DEBUG);
 #endif // YAGI_DEBUG 
 
-    while (!WindowShouldClose()) {
+    while (!WindowShouldClose() && !yagi_ui_replay_done()) {
         BeginDrawing();
         ClearBackground(RAYWHITE);
 
@@ -31,6 +34,7 @@ int main(void) {
         EndDrawing();
     }
 
+    yagi_ui_close_input_log();
     CloseWindow();
     return 0;
 }
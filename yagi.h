@@ -3,53 +3,760 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <assert.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
 
 #include <raylib.h>
+#include <rlgl.h>
 
 typedef uint64_t UIID;
 typedef enum { LAYOUT_HORZ, LAYOUT_VERT }LayoutType;
 
+#define YAGI_LAYER_BASE 0
+#define YAGI_LAYER_POPUP 1
+
+typedef struct {
+    Vector2 offset;
+    Vector2 content_size;
+}YagiScroll;
+
+typedef enum { YAGI_ALIGN_START, YAGI_ALIGN_CENTER, YAGI_ALIGN_END, YAGI_ALIGN_STRETCH }YagiAlign;
+
+// How a widget is sized and aligned inside of a container. The space a container has
+// left over (or lacks) is shared by its children in proportion to grow (or shrink
+// times their own size). A zero max_size component means unbounded.
+typedef struct {
+    float grow, shrink;
+    YagiAlign align;
+    Vector2 min_size, max_size;
+}YagiFlex;
+
+// Flex solution of a container, kept across frames in the state store. It is solved from
+// the sizes measured in the previous frame, and another frame is laid out when it changes.
+// A child ends up with its natural size plus grow * grow_unit, minus shrink * natural size
+// * shrink_unit, clamped to its min_size and max_size.
+typedef struct {
+    float cross_size;
+    float grow_unit, shrink_unit, main_offset;
+}YagiFlexCache;
+
+// A child of a container that can change its size along the main axis, recorded for the solve
+typedef struct YagiFlexItem {
+    // Natural size clamped to min and max, and shrink already scaled by it
+    float natural, grow, shrink;
+    float min, max;
+    float size;
+    bool frozen;
+    struct YagiFlexItem* next;
+}YagiFlexItem;
+
+#ifndef YAGI_DROPDOWN_MAX_VISIBLE
+#define YAGI_DROPDOWN_MAX_VISIBLE 10
+#endif // YAGI_DROPDOWN_MAX_VISIBLE
+#ifndef YAGI_DROPDOWN_QUERY_MAX
+#define YAGI_DROPDOWN_QUERY_MAX 64
+#endif // YAGI_DROPDOWN_QUERY_MAX
+
+// Type-ahead filter of yagi_dropdown_filtered. Text typed while the dropdown is open only
+// keeps the labels containing it (ASCII case insensitive). The substring index is built the
+// first time the dropdown opens and again only when the labels array or its length change.
+typedef struct {
+    char** labels;
+    size_t label_count;
+
+    // Lowercased labels, each followed by a 0, and the label every byte belongs to
+    char* text;
+    uint32_t* owners;
+    // Positions in text, sorted by the suffix starting there
+    uint32_t* suffixes;
+    size_t suffix_count;
+
+    uint32_t* marks;
+    uint32_t mark;
+
+    char query[YAGI_DROPDOWN_QUERY_MAX];
+    size_t query_len;
+    bool query_dirty;
+    uint32_t* matches;
+    size_t match_count;
+}YagiDropdownFilter;
+
+#ifndef YAGI_TABLE_CELL_PADDING
+#define YAGI_TABLE_CELL_PADDING 4
+#endif // YAGI_TABLE_CELL_PADDING
+#ifndef YAGI_TABLE_MIN_COLUMN_WIDTH
+#define YAGI_TABLE_MIN_COLUMN_WIDTH 20
+#endif // YAGI_TABLE_MIN_COLUMN_WIDTH
+#ifndef YAGI_TABLE_CELL_MAX
+#define YAGI_TABLE_CELL_MAX 256
+#endif // YAGI_TABLE_CELL_MAX
+
+typedef struct {
+    const char* title;
+    // Changed by dragging the right edge of the column's header
+    float width;
+}YagiTableColumn;
+
+// Returns the text of a cell, either formatted into buf or a string that stays valid until
+// yagi_ui_end. NULL leaves the cell empty.
+typedef const char* (*YagiTableCell)(void* user, size_t row, size_t column, char* buf, size_t buf_size);
+
+typedef struct {
+    YagiTableColumn* columns;
+    size_t column_count;
+    size_t row_count;
+    // 0 means the font size plus YAGI_TABLE_CELL_PADDING above and below
+    float row_height;
+    YagiTableCell cell;
+    void* user;
+}YagiTable;
+
 typedef struct {
     LayoutType type;
     Vector2 pos;
     Vector2 size;
     float padding;
 
+    // Set for layouts created by yagi_begin_scroll
+    YagiScroll* scroll;
+    Rectangle view;
+    uint16_t parent_clip;
+    size_t cull_start;
+
+    // Set for layouts created by yagi_begin_rows. Every row advances the layout by row_height.
+    float row_height;
+    size_t row_count;
+
+    // Set for layouts created by yagi_begin_container
+    uint64_t id;
+    Vector2 fixed_size;
+    YagiAlign justify;
+    YagiFlexCache solved;
+    float natural_main, cross_size;
+    YagiFlexItem* flex_items;
+    YagiFlex next;
+    bool has_next, placed;
+    float placed_main;
+
     const char* file;
     int line;
 }Layout;
 
+// A glyph rasterized on demand into one of the atlas pages of a YagiFont
+typedef struct {
+    int codepoint; // -1 means the entry is empty
+    int page;      // -1 if the glyph has no bitmap (e.g. space)
+    uint32_t page_generation;
+    Rectangle rec;
+    float offset_x, offset_y, advance_x;
+}YagiGlyph;
+
+typedef struct {
+    int pixel_size;
+    YagiGlyph* glyphs;
+    size_t glyph_count;
+    size_t glyph_capacity;
+}YagiFontSize;
+
+typedef struct {
+    int y, height, x;
+}YagiShelf;
+
+#ifndef YAGI_GLYPH_PAGE_SIZE
+#define YAGI_GLYPH_PAGE_SIZE 1024
+#endif // YAGI_GLYPH_PAGE_SIZE
+#ifndef YAGI_GLYPH_PAGE_MAX_COUNT
+#define YAGI_GLYPH_PAGE_MAX_COUNT 8
+#endif // YAGI_GLYPH_PAGE_MAX_COUNT
+#ifndef YAGI_GLYPH_PAGE_MAX_SHELVES
+#define YAGI_GLYPH_PAGE_MAX_SHELVES 128
+#endif // YAGI_GLYPH_PAGE_MAX_SHELVES
+
+// Shelf packed atlas page holding glyphs of a single pixel size. The pixels are kept on
+// the CPU and the rows in [dirty_y0, dirty_y1) are uploaded before the page is drawn.
+typedef struct {
+    Texture2D texture;
+    unsigned char* pixels; // gray + alpha
+    int dirty_y0, dirty_y1;
+
+    int pixel_size;
+    uint32_t generation;
+    size_t last_used;
+
+    YagiShelf shelves[YAGI_GLYPH_PAGE_MAX_SHELVES];
+    size_t shelf_count;
+    int shelf_bottom;
+}YagiGlyphPage;
+
+// A TTF/OTF font rasterized lazily, glyph by glyph, at any pixel size. Pages that were
+// not used in the current frame are evicted least recently used first when full.
+// The font counts frames itself since contexts count theirs independently.
+typedef struct {
+    unsigned int id;
+    unsigned char* file_data;
+    int file_size;
+
+    YagiFontSize* sizes;
+    size_t size_count;
+    size_t size_capacity;
+
+    YagiGlyphPage pages[YAGI_GLYPH_PAGE_MAX_COUNT];
+    size_t page_count;
+
+    // Frames that used the font, pages are stamped with it for the LRU
+    size_t frame;
+    // Value of the global frame count when frame was last advanced
+    size_t frame_epoch;
+
+    // Contexts recorded on other threads share the font, see YagiContext
+    atomic_flag lock;
+}YagiFont;
+
 typedef struct {
     Color bg_color, text_color;
     int font_size, font_spacing;
 
     Font font;
+    // If set, text is drawn with this font instead of font
+    YagiFont* dynamic_font;
 }YagiStyle;
 
+typedef struct {
+    Font font;
+    YagiFont* dynamic;
+}YagiDrawFont;
+
+// Textured quad, the unit of batched glyph drawing
+typedef struct {
+    Rectangle source, dest;
+    Color color;
+}YagiQuad;
+
+// Everything yagi needs from the platform. Text with raylib Fonts is measured by the backend.
+// With draw_quads the glyphs of all text are laid out by yagi and drawn in one batch per
+// atlas texture, without it text goes through draw_text, draw_codepoints and draw_texture.
+typedef struct {
+    Vector2 (*measure_text)(Font font, const char* text, float font_size, float font_spacing);
+    float (*codepoint_advance)(Font font, int codepoint, float font_size);
+
+    void (*draw_rect)(Rectangle rect, Color color);
+    void (*draw_border)(Rectangle rect, float thickness, Color color);
+    void (*draw_circle)(Vector2 center, float radius, Color color);
+    void (*draw_text)(Font font, const char* text, Vector2 pos, float font_size, float font_spacing, Color color);
+    void (*draw_codepoints)(Font font, const int* codepoints, int count, Vector2 pos, float font_size, float font_spacing, Color color);
+    void (*draw_texture)(Texture2D texture, Rectangle source, Rectangle dest, Color color);
+    void (*begin_clip)(Rectangle rect);
+    void (*end_clip)(void);
+
+    Texture2D (*load_texture)(Image image);
+    void (*update_texture)(Texture2D texture, Rectangle rect, const void* pixels);
+    void (*unload_texture)(Texture2D texture);
+
+    Vector2 (*screen_size)(void);
+    Vector2 (*mouse_position)(void);
+    Vector2 (*mouse_delta)(void);
+    Vector2 (*mouse_wheel)(void);
+    bool (*is_mouse_down)(int button);
+    bool (*is_mouse_pressed)(int button);
+    bool (*is_mouse_released)(int button);
+    bool (*is_key_down)(int key);
+    bool (*is_key_pressed)(int key);
+    bool (*is_key_pressed_repeat)(int key);
+    bool (*is_key_released)(int key);
+    int (*char_pressed)(void);
+    const char* (*get_clipboard)(void);
+    void (*set_clipboard)(const char* text);
+
+    // Optional, called around every frame by yagi_ui_begin and yagi_ui_end
+    void (*begin_frame)(void);
+    void (*end_frame)(void);
+    // Optional, blocks the next frame until input arrives while wait is set
+    void (*wait_events)(bool wait);
+    // Optional, seconds the last frame took
+    float (*frame_time)(void);
+    // Optional, draws count quads of texture at once
+    void (*draw_quads)(Texture2D texture, const YagiQuad* quads, size_t count);
+
+    // Optional, lets idle mode keep the last frame instead of drawing it again: the frame is
+    // drawn into cache between begin_cache and end_cache and put on the screen by present_cache.
+    // Without them every frame is drawn in full.
+    RenderTexture2D (*load_cache)(Vector2 size);
+    void (*unload_cache)(RenderTexture2D cache);
+    void (*begin_cache)(RenderTexture2D cache);
+    void (*end_cache)(void);
+    void (*present_cache)(RenderTexture2D cache);
+}YagiBackend;
+
+// Glyph quads of one texture waiting to be drawn
+typedef struct {
+    Texture2D texture;
+    YagiQuad* quads;
+    size_t count;
+    size_t capacity;
+}YagiQuadStream;
+
+#ifndef YAGI_GLYPH_LUT_DIRECT
+#define YAGI_GLYPH_LUT_DIRECT 256
+#endif // YAGI_GLYPH_LUT_DIRECT
+
+// Glyph indices of a raylib Font, in place of the linear search of GetGlyphIndex. Codepoints
+// below YAGI_GLYPH_LUT_DIRECT are indexed directly, the others go through an open addressing
+// table of (codepoint, index) pairs. Missing codepoints map to the '?' glyph like in raylib.
+typedef struct {
+    const GlyphInfo* glyphs;
+    int glyph_count;
+    int fallback;
+    int direct[YAGI_GLYPH_LUT_DIRECT];
+    int* slots;
+    size_t slot_mask;
+}YagiGlyphLut;
+
+typedef enum {
+    YAGI_HEADLESS_RECT,
+    YAGI_HEADLESS_BORDER,
+    YAGI_HEADLESS_CIRCLE,
+    YAGI_HEADLESS_TEXT,
+    YAGI_HEADLESS_TEXTURE,
+    YAGI_HEADLESS_CLIP,
+    // The cached frame of idle mode put on the screen
+    YAGI_HEADLESS_PRESENT,
+}YagiHeadlessCallKind;
+
+// Draw call recorded by the headless backend. For text, rect is the position and the
+// measured size, and the UTF-8 text is text_count bytes at yagi_headless.text + text.
+typedef struct {
+    YagiHeadlessCallKind kind;
+    Rectangle rect;
+    float size;
+    Color color;
+    size_t text;
+    size_t text_count;
+}YagiHeadlessCall;
+
+#ifndef YAGI_HEADLESS_CHAR_MAX_COUNT
+#define YAGI_HEADLESS_CHAR_MAX_COUNT 256
+#endif // YAGI_HEADLESS_CHAR_MAX_COUNT
+#ifndef YAGI_HEADLESS_GLYPH_WIDTH
+#define YAGI_HEADLESS_GLYPH_WIDTH 0.5f
+#endif // YAGI_HEADLESS_GLYPH_WIDTH
+
+// State of the headless backend: the draw calls of the last frame and the input of the
+// next one. Every glyph is YAGI_HEADLESS_GLYPH_WIDTH * font_size wide and font_size tall.
+typedef struct {
+    YagiHeadlessCall* calls;
+    size_t call_count;
+    size_t call_capacity;
+    char* text;
+    size_t text_count;
+    size_t text_capacity;
+
+    Vector2 screen_size;
+    Vector2 mouse, previous_mouse;
+    Vector2 wheel;
+    bool mouse_down[3], previous_mouse_down[3];
+    bool key_down[512], previous_key_down[512];
+    bool key_repeat[512];
+    int chars[YAGI_HEADLESS_CHAR_MAX_COUNT];
+    size_t char_count, char_read;
+    char* clipboard;
+}YagiHeadless;
+
+typedef enum {
+    YAGI_CMD_RECT,
+    YAGI_CMD_BORDER,
+    YAGI_CMD_CIRCLE,
+    YAGI_CMD_TEXT,
+    YAGI_CMD_CODEPOINTS,
+}YagiDrawCmdKind;
+
+// A deferred draw command. Widgets record these during the frame and
+// yagi_ui_end sorts and submits them, so the meaning of the fields depends on kind:
+//   RECT, BORDER: rect is the rectangle, size is the border thickness
+//   CIRCLE:       rect.x/rect.y is the center, size is the radius
+//   TEXT:         rect.x/rect.y is the position, size/spacing are the font size/spacing,
+//                 data is a NUL terminated string in the frame arena
+//   CODEPOINTS:   same as TEXT, but data is an array of data_count codepoints
+typedef struct {
+    uint8_t kind;
+    uint8_t font;
+    uint16_t layer;
+    uint16_t clip;
+    uint32_t seq;
+
+    Rectangle rect;
+    float size, spacing;
+    Color color;
+
+    const void* data;
+    uint32_t data_count;
+}YagiDrawCmd;
+
+typedef struct {
+    uint64_t key;
+    uint32_t index;
+}YagiDrawKey;
+
+typedef struct YagiArenaChunk {
+    struct YagiArenaChunk* next;
+    size_t capacity;
+    size_t used;
+    _Alignas(16) unsigned char data[];
+}YagiArenaChunk;
+
+// Bump allocator whose chunks are kept when it is reset, so after the first few
+// frames allocating from it never calls malloc.
+typedef struct {
+    YagiArenaChunk* first;
+    YagiArenaChunk* current;
+}YagiArena;
+
+typedef struct {
+    uint64_t hash; // 0 means the entry is empty
+    unsigned int font_id;
+    int font_size, font_spacing;
+    size_t last_used;
+    Vector2 size;
+}YagiMeasureEntry;
+
+#ifndef YAGI_STATE_DATA_SIZE
+#define YAGI_STATE_DATA_SIZE 32
+#endif // YAGI_STATE_DATA_SIZE
+
+#ifndef YAGI_STATE_CHUNK_SIZE
+#define YAGI_STATE_CHUNK_SIZE 256
+#endif // YAGI_STATE_CHUNK_SIZE
+
+// Storage of yagi_state_get, allocated in chunks so it does not move when the table of ids grows
+typedef union YagiStateData {
+    unsigned char bytes[YAGI_STATE_DATA_SIZE];
+    double align_;
+    // Next free data while it is unused
+    union YagiStateData* next_free;
+}YagiStateData;
+
+// Persistent per-widget storage. Entries whose id was not seen in a frame are dropped at its end.
+typedef struct {
+    UIID id; // 0 means the entry is empty
+    size_t last_seen;
+    // Times the id was requested again this frame, see yagi_id_with_loc
+    size_t repeats;
+    // Allocated by the first yagi_state_get
+    YagiStateData* data;
+}YagiStateEntry;
+
+typedef enum {
+    YAGI_WIDGET_TEXT,
+    YAGI_WIDGET_EMPTY,
+    YAGI_WIDGET_BUTTON,
+    YAGI_WIDGET_DROPDOWN,
+    YAGI_WIDGET_INPUT,
+    YAGI_WIDGET_SLIDER,
+    YAGI_WIDGET_CHECKBOX,
+    YAGI_WIDGET_TABLE,
+    YAGI_WIDGET_KIND_COUNT,
+}YagiWidgetKind;
+
+// Counters of one frame. Not gathered at all when YAGI_NO_STATS is defined.
+typedef struct {
+    uint64_t frame_ns;
+    uint32_t widgets[YAGI_WIDGET_KIND_COUNT];
+    // Time spent inside of each widget function
+    uint64_t widget_ns[YAGI_WIDGET_KIND_COUNT];
+    uint32_t peak_layout_count;
+    uint32_t text_measures;
+    uint32_t measure_misses;
+    // Calls into the backend that draw or clip. A batch of glyph quads is one call.
+    uint32_t draw_calls;
+    uint64_t bytes_formatted;
+    // Time of the previous frame as the backend reports it, and as it was logged while replaying
+    float frame_time_ms;
+    float logged_frame_time_ms;
+}YagiFrameStats;
+
+typedef struct {
+    float min, avg, p99;
+}YagiStatRange;
+
+// Statistics over the last frames (at most YAGI_STATS_FRAMES), returned by yagi_ui_stats
+typedef struct {
+    size_t frames;
+    YagiFrameStats last;
+    YagiStatRange frame_ms;
+    YagiStatRange frame_time_ms;
+    YagiStatRange logged_frame_time_ms;
+    YagiStatRange widgets;
+    YagiStatRange widget_ms[YAGI_WIDGET_KIND_COUNT];
+    YagiStatRange peak_layout_count;
+    YagiStatRange text_measures;
+    YagiStatRange measure_misses;
+    YagiStatRange draw_calls;
+    YagiStatRange bytes_formatted;
+}YagiStats;
+
+// Hit area of an interactive widget, already clipped
+typedef struct {
+    Rectangle rect;
+    UIID id;
+    uint16_t layer;
+}YagiHitRect;
+
+#ifndef YAGI_INPUT_CHAR_MAX_COUNT
+#define YAGI_INPUT_CHAR_MAX_COUNT 256
+#endif // YAGI_INPUT_CHAR_MAX_COUNT
+#define YAGI_INPUT_KEY_COUNT (KEY_KB_MENU + 1)
+#define YAGI_INPUT_BUTTON_COUNT (MOUSE_BUTTON_BACK + 1)
+
+// Input of one frame, read from the backend once by yagi_ui_begin. Keys and mouse
+// buttons are bit sets indexed by KeyboardKey and MouseButton.
+typedef struct {
+    float frame_time;
+    Vector2 screen_size;
+    Vector2 mouse, mouse_delta, wheel;
+    uint8_t mouse_down, mouse_pressed, mouse_released;
+    uint8_t key_down[(YAGI_INPUT_KEY_COUNT + 7) / 8];
+    uint8_t key_pressed[(YAGI_INPUT_KEY_COUNT + 7) / 8];
+    uint8_t key_repeat[(YAGI_INPUT_KEY_COUNT + 7) / 8];
+    uint8_t key_released[(YAGI_INPUT_KEY_COUNT + 7) / 8];
+    // Every codepoint typed since the last frame, in order
+    int chars[YAGI_INPUT_CHAR_MAX_COUNT];
+    size_t char_count;
+}YagiInput;
+
+// Input of one frame read on the main thread, for contexts recorded on other threads (see
+// yagi_ctx_set_input). The clipboard is only read when the frame pastes.
+typedef struct {
+    YagiInput input;
+    char* clipboard;
+    size_t clipboard_capacity;
+    bool clipboard_set;
+}YagiInputSnapshot;
+
 typedef struct {
     UIID active, focus, highlight;
-    UIID id_counter;
+    // Topmost widget under the mouse, picked from the hit areas of the previous frame
+    UIID hot;
+
+#ifndef YAGI_ID_STACK_MAX_COUNT
+#define YAGI_ID_STACK_MAX_COUNT 64
+#endif // YAGI_ID_STACK_MAX_COUNT
+    UIID id_stack[YAGI_ID_STACK_MAX_COUNT];
+    size_t id_stack_count;
+
+    YagiStateEntry* states;
+    YagiStateEntry* states_spare;
+    size_t state_count;
+    size_t state_capacity;
+    size_t state_seen;
+    YagiStateData** state_chunks;
+    size_t state_chunk_count;
+    YagiStateData* state_free;
 
     YagiStyle style;
 
     size_t start_counter;
+    size_t frame_index;
+
+    // Set when a container had to be re-solved, its children move in the next frame
+    bool relayout;
+    // Set by yagi_ui_request_frame, for widgets that animate
+    bool frame_requested;
+    // Set when mouse or keyboard input arrived since the last frame
+    bool had_input;
+    YagiInput input;
+    // Set by yagi_ctx_set_input for the next frame, and whether the current frame got its input that way
+    YagiInput next_input;
+    bool next_input_set;
+    bool input_given;
+    // Text copied in a deferred context, handed to the backend by yagi_ctx_composite
+    char* copy_text;
+    size_t copy_capacity;
+    bool copy_set;
+
+    // Input log (see yagi_ui_record_input). A clipboard read is logged with the frame that read it.
+    FILE* record_file;
+    FILE* replay_file;
+    bool replay_done;
+    // Whether the current frame got its input from the log
+    bool input_replayed;
+    char* log_clipboard;
+    size_t log_clipboard_capacity;
+    bool log_clipboard_set;
+
+    // Idle mode (see yagi_ui_set_idle_mode). The last frame is kept in frame_cache and
+    // presented again as long as the hash of the recorded commands does not change.
+    bool idle_mode;
+    bool event_waiting;
+    bool frame_cached;
+    uint64_t frame_hash;
+    RenderTexture2D frame_cache;
+
+    // Open addressing cache of text sizes. Entries not used for YAGI_MEASURE_CACHE_MAX_AGE
+    // frames are reused for new text, so steady text never gets measured twice.
+#ifndef YAGI_MEASURE_CACHE_SIZE
+#define YAGI_MEASURE_CACHE_SIZE 4096
+#endif // YAGI_MEASURE_CACHE_SIZE
+#ifndef YAGI_MEASURE_CACHE_MAX_AGE
+#define YAGI_MEASURE_CACHE_MAX_AGE 60
+#endif // YAGI_MEASURE_CACHE_MAX_AGE
+#ifndef YAGI_MEASURE_CACHE_PROBE
+#define YAGI_MEASURE_CACHE_PROBE 16
+#endif // YAGI_MEASURE_CACHE_PROBE
+    YagiMeasureEntry measure_cache[YAGI_MEASURE_CACHE_SIZE];
+    size_t measure_hits, measure_misses;
+
+    // Draw layer of the widgets being recorded. Higher layers are drawn on top.
+    uint16_t layer;
+
+    // Clip rectangles used this frame. Index 0 means no clipping.
+#ifndef YAGI_CLIP_MAX_COUNT
+#define YAGI_CLIP_MAX_COUNT 4096
+#endif // YAGI_CLIP_MAX_COUNT
+    _Static_assert(YAGI_CLIP_MAX_COUNT <= 4096, "YAGI_CLIP_MAX_COUNT must fit in the 12 clip bits of the draw sort key");
+    Rectangle clip_rects[YAGI_CLIP_MAX_COUNT];
+    size_t clip_rect_count;
+    uint16_t clip;
+    bool wheel_consumed;
+    // Widgets and rows skipped by culling, their width is not known
+    size_t cull_count;
+
+    // Hit areas recorded this frame, and the ones of the previous frame bucketed into a
+    // uniform grid of YAGI_HIT_CELL_SIZE cells. grid_cells[i]..grid_cells[i + 1] is the
+    // range of grid_items (indices into prev_hits) overlapping cell i.
+#ifndef YAGI_HIT_CELL_SIZE
+#define YAGI_HIT_CELL_SIZE 64
+#endif // YAGI_HIT_CELL_SIZE
+    YagiHitRect* hits;
+    size_t hit_count;
+    size_t hit_capacity;
+    YagiHitRect* prev_hits;
+    size_t prev_hit_count;
+    size_t prev_hit_capacity;
+    uint32_t* grid_cells;
+    size_t grid_cells_capacity;
+    uint32_t* grid_items;
+    size_t grid_items_capacity;
+    int grid_cols, grid_rows;
+
+    YagiDrawCmd* cmds;
+    size_t cmd_count;
+    size_t cmd_capacity;
+
+    YagiDrawKey* cmd_keys;
+    size_t cmd_keys_capacity;
+
+    // Transient allocations of the current frame, reset by yagi_ui_begin
+    YagiArena frame_arena;
+
+#ifndef YAGI_FONT_MAX_COUNT
+#define YAGI_FONT_MAX_COUNT 16
+#endif // YAGI_FONT_MAX_COUNT
+    _Static_assert(YAGI_FONT_MAX_COUNT < 256, "YAGI_FONT_MAX_COUNT must fit in the 8 group bits of the draw sort key");
+    YagiDrawFont fonts[YAGI_FONT_MAX_COUNT];
+    size_t font_count;
+
+    // Lookup tables of the raylib fonts drawn, replaced round robin
+    YagiGlyphLut glyph_luts[YAGI_FONT_MAX_COUNT];
+    size_t glyph_lut_next;
+
+    // Glyph quads of the text being drawn, one stream per atlas texture
+#ifndef YAGI_QUAD_STREAM_MAX_COUNT
+#define YAGI_QUAD_STREAM_MAX_COUNT (YAGI_GLYPH_PAGE_MAX_COUNT + 1)
+#endif // YAGI_QUAD_STREAM_MAX_COUNT
+    YagiQuadStream quad_streams[YAGI_QUAD_STREAM_MAX_COUNT];
+    size_t quad_stream_count;
 
 #ifndef YAGI_LAYOUT_MAX_COUNT
 #define YAGI_LAYOUT_MAX_COUNT 1024
 #endif // YAGI_LAYOUT_MAX_COUNT
     Layout layout_stack[YAGI_LAYOUT_MAX_COUNT];
     size_t layout_count;
+
+    // Set for contexts recorded off the main thread. yagi_ui_end keeps the recorded
+    // commands and yagi_ctx_composite draws them later on the main thread.
+    bool deferred;
+    bool cmds_sorted;
+
+    // NULL means yagi_backend_raylib
+    const YagiBackend* backend;
+
+#ifndef YAGI_NO_STATS
+#ifndef YAGI_STATS_FRAMES
+#define YAGI_STATS_FRAMES 120
+#endif // YAGI_STATS_FRAMES
+    YagiFrameStats stats;
+    uint64_t stats_frame_start;
+    // Ring buffer of the last finished frames
+    YagiFrameStats stats_history[YAGI_STATS_FRAMES];
+    size_t stats_history_count;
+    size_t stats_history_next;
+#endif // YAGI_NO_STATS
 }YagiUi;
 
+// All of the state of one UI. The functions without a ctx parameter use the current
+// context of the calling thread, which starts out as a context shared by all threads.
+//
+// Independent UIs can be recorded in parallel, each on its own thread with its own
+// deferred context made current, as long as yagi_ctx_composite is called on the main
+// thread after their yagi_ui_end and before their next yagi_ui_begin.
+typedef YagiUi YagiContext;
+
+// Text of an input widget, stored as a gap buffer of codepoints. The text is
+// codepoints[0, gap_start) followed by codepoints[gap_end, capacity), and edits happen at the gap.
+//
+// xs holds the x position of every codepoint with the same layout: absolute positions before
+// the gap and distances to the end of the text (width) after it, so edits and cursor moves only
+// touch the codepoints next to the gap.
 typedef struct {
     int* codepoints;
+    float* xs;
     size_t count;
     size_t capacity;
+    size_t gap_start, gap_end;
+
+    // x position of the end of the text, measured with this font
+    float width;
+    unsigned int font_id;
+    int font_size, font_spacing;
+
+    // Selection is [min(cursor, anchor), max(cursor, anchor))
+    size_t cursor, anchor;
+    float scroll;
 }InputBuffer;
 
-UIID yagi_id_next();
+// Returns the text as contiguous codepoints (count of them)
+const int* yagi_input_buffer_codepoints(InputBuffer* self);
+void yagi_input_buffer_set_text(InputBuffer* self, const char* text);
+void yagi_input_buffer_free(InputBuffer* self);
+
+// Returns an id that is stable across frames, hashed from the call location and the id scope.
+// Repeated locations within one scope get distinct ids in order of appearance, but loops whose
+// item count or order changes should give every item its own scope with yagi_push_id.
+UIID yagi_id_with_loc(const char* file, int line);
+void yagi_push_id(uint64_t value);
+void yagi_push_id_str(const char* str);
+void yagi_pop_id();
+
+// Returns zero initialized storage of size bytes (at most YAGI_STATE_DATA_SIZE) that persists
+// across frames as long as id is used every frame. The pointer stays valid until the first frame
+// that does not use id ends.
+void* yagi_state_get(UIID id, size_t size);
+#define yagi_state(id, type) ((type*)yagi_state_get(id, sizeof(type)))
+
+// Allocations that live until the next yagi_ui_begin
+void* yagi_frame_alloc(size_t size);
+char* yagi_frame_printf(const char* fmt, ...);
+char* yagi_frame_vprintf(const char* fmt, va_list args);
+// Returns the codepoints encoded as UTF-8, allocated in the frame arena
 char* yagi_utf8_temp(int* codepoints, int codepoints_count);
 
+// Measures text with the current style, going through the measurement cache
+Vector2 yagi_measure_text(const char* text);
+Vector2 yagi_measure_text_ex(Font font, const char* text, int font_size, int font_spacing);
+
+YagiFont* yagi_font_load(const char* path);
+void yagi_font_unload(YagiFont* font);
+
 static void yagi_expand_layout_with_loc(Vector2 size, const char* file, int line);
 static Vector2 yagi_next_widget_pos_with_loc(const char* file, int line);
 
@@ -60,8 +767,53 @@ void yagi_ui_begin_with_loc(const char* file, int line);
 void yagi_begin_layout_with_loc(LayoutType type, Vector2 pos, float padding, const char* file, int line);
 void yagi_begin_sublayout_with_loc(LayoutType type, float padding, const char* file, int line);
 void yagi_end_layout_with_loc(const char* file, int line);
+// Scrollable, clipped container of the given size. Widgets outside of it are only laid out.
+void yagi_begin_scroll_with_loc(Vector2 size, YagiScroll* scroll, const char* file, int line);
+void yagi_end_scroll_with_loc(const char* file, int line);
+// Layout of a fixed size whose children can grow, shrink and align (see yagi_flex). A zero
+// component of size makes it size to its content along that axis. Ended with yagi_end_layout.
+void yagi_begin_container_with_loc(LayoutType type, Vector2 size, YagiAlign justify, float padding, const char* file, int line);
+// Flex settings of the next widget in the current container
+void yagi_flex_with_loc(YagiFlex flex, const char* file, int line);
+// Vertical list of row_count rows, each row_height tall. Only rows [*first, *last) are visible
+// and need to be emitted, the space of the others is reserved by yagi_end_rows.
+void yagi_begin_rows_with_loc(float row_height, size_t row_count, size_t* first, size_t* last, const char* file, int line);
+void yagi_end_rows_with_loc(const char* file, int line);
 void yagi_ui_end_with_loc(const char* file, int line);
 
+// True when the UI can change without new input: a widget is active or focused, a container
+// was re-solved, input arrived this frame, an input log is replayed or yagi_ui_request_frame
+// was called. Meant to be checked after yagi_ui_end.
+bool yagi_ui_needs_frame();
+// Asks for another frame, for widgets that animate
+void yagi_ui_request_frame();
+// In idle mode yagi_ui_end makes raylib wait for events while no frame is needed, and
+// frames that record the same commands as the previous one are presented from a cached
+// render texture instead of being drawn again, if the backend has the cache hooks.
+void yagi_ui_set_idle_mode(bool enabled);
+
+// Snapshot of the statistics of the last frames. All zeros with YAGI_NO_STATS.
+YagiStats yagi_ui_stats();
+// Input of the current frame, as the widgets see it
+const YagiInput* yagi_ui_input();
+// Reads the input of the backend into snapshot, draining its character queue. Called on the
+// main thread once per frame, and handed to every context with yagi_ctx_set_input.
+void yagi_input_snapshot(YagiInputSnapshot* snapshot);
+void yagi_input_snapshot_free(YagiInputSnapshot* snapshot);
+// Appends the input of every following frame to a binary log at path, until
+// yagi_ui_close_input_log. Returns false if the file can not be created.
+bool yagi_ui_record_input(const char* path);
+// Feeds the frames of a log written by yagi_ui_record_input to the widgets in place of
+// the backend input. The same frames with the same UI code end in the same widget state.
+// Frame time comes from the log too, yagi_ui_stats has the live one next to it.
+bool yagi_ui_replay_input(const char* path);
+// True once the last frame of a replayed log was read. The input is live again after it.
+bool yagi_ui_replay_done();
+void yagi_ui_close_input_log();
+// Starts recording for --record FILE or replaying for --replay FILE on the command line.
+// Prints the usage or the error and returns false for anything else.
+bool yagi_ui_input_log_args(int argc, char* argv[]);
+
 void yagi_ui_set_default_style();
 YagiStyle* yagi_ui_get_style();
 YagiStyle yagi_ui_get_style_copy();
@@ -69,28 +821,134 @@ YagiStyle yagi_ui_get_style_copy();
 void yagi_text_with_loc(const char* file, int line, const char* fmt, ...);
 void yagi_empty_with_loc(Vector2 size, const char* file, int line);
 bool yagi_button_with_loc(const char* label, const char* file, int line);
+// Popup lists at most YAGI_DROPDOWN_MAX_VISIBLE labels at a time and scrolls
 bool yagi_dropdown_with_loc(int* already_selected, char* labels[], size_t label_count, const char* file, int line);
-// TODO: add selection
-// TODO: key things (moving by word, etc.)
+bool yagi_dropdown_filtered_with_loc(int* already_selected, char* labels[], size_t label_count, YagiDropdownFilter* filter, const char* file, int line);
+void yagi_dropdown_filter_free(YagiDropdownFilter* filter);
 bool yagi_input_with_loc(int width, InputBuffer* input_buffer, const char* file, int line);
 bool yagi_slider_with_loc(int width, float* value_ptr, const char* file, int line);
 bool yagi_checkbox_with_loc(Vector2 size, bool* checked_ptr, const char* file, int line);
+// Rows of fixed height under a header that stays in place while they scroll. Only the cells
+// of the visible rows are asked for, so a table costs the same for 50 or 1M rows.
+// Dragging the edge of a header writes the new width to the column in table.
+void yagi_table_with_loc(Vector2 size, YagiTable* table, YagiScroll* scroll, const char* file, int line);
+// Draws the statistics of yagi_ui_stats as text
+void yagi_stats_overlay_with_loc(const char* file, int line);
+
+extern const YagiBackend yagi_backend_raylib;
+extern const YagiBackend yagi_backend_headless;
+extern YagiHeadless yagi_headless;
+
+void yagi_ui_set_backend(const YagiBackend* backend);
+
+// Scripted input of the headless backend, seen by the next frame
+void yagi_headless_set_screen_size(Vector2 size);
+void yagi_headless_set_mouse(Vector2 pos);
+void yagi_headless_set_mouse_button(int button, bool down);
+void yagi_headless_set_key(int key, bool down);
+// Presses key again while it is held, like a key repeat
+void yagi_headless_repeat_key(int key);
+void yagi_headless_scroll(Vector2 wheel);
+void yagi_headless_type(const char* text);
+void yagi_headless_set_clipboard(const char* text);
+void yagi_headless_free();
+
+YagiContext* yagi_ctx_create();
+void yagi_ctx_destroy(YagiContext* ctx);
+// Makes ctx (or the default context for NULL) current on the calling thread and returns the previous one
+YagiContext* yagi_ctx_make_current(YagiContext* ctx);
+YagiContext* yagi_ctx_current();
+// A deferred context never calls the backend while recording: its input comes from
+// yagi_ctx_set_input (none without it) and copied text goes to the clipboard in yagi_ctx_composite.
+void yagi_ctx_set_deferred(YagiContext* ctx, bool deferred);
+// The next yagi_ui_begin of ctx uses snapshot instead of reading the backend
+void yagi_ctx_set_input(YagiContext* ctx, const YagiInputSnapshot* snapshot);
+// Draws what a deferred context recorded in its last frame, on the main thread
+void yagi_ctx_composite(YagiContext* ctx);
+bool yagi_ctx_needs_frame(YagiContext* ctx);
+
+UIID yagi_ctx_id_with_loc(YagiContext* ctx, const char* file, int line);
+void yagi_ctx_ui_begin_with_loc(YagiContext* ctx, const char* file, int line);
+void yagi_ctx_begin_layout_with_loc(YagiContext* ctx, LayoutType type, Vector2 pos, float padding, const char* file, int line);
+void yagi_ctx_begin_sublayout_with_loc(YagiContext* ctx, LayoutType type, float padding, const char* file, int line);
+void yagi_ctx_end_layout_with_loc(YagiContext* ctx, const char* file, int line);
+Vector2 yagi_ctx_next_widget_pos_with_loc(YagiContext* ctx, const char* file, int line);
+void yagi_ctx_expand_layout_with_loc(YagiContext* ctx, Vector2 size, const char* file, int line);
+void yagi_ctx_begin_scroll_with_loc(YagiContext* ctx, Vector2 size, YagiScroll* scroll, const char* file, int line);
+void yagi_ctx_end_scroll_with_loc(YagiContext* ctx, const char* file, int line);
+void yagi_ctx_begin_container_with_loc(YagiContext* ctx, LayoutType type, Vector2 size, YagiAlign justify, float padding, const char* file, int line);
+void yagi_ctx_flex_with_loc(YagiContext* ctx, YagiFlex flex, const char* file, int line);
+void yagi_ctx_begin_rows_with_loc(YagiContext* ctx, float row_height, size_t row_count, size_t* first, size_t* last, const char* file, int line);
+void yagi_ctx_end_rows_with_loc(YagiContext* ctx, const char* file, int line);
+void yagi_ctx_ui_end_with_loc(YagiContext* ctx, const char* file, int line);
+
+void yagi_ctx_text_with_loc(YagiContext* ctx, const char* file, int line, const char* fmt, ...);
+void yagi_ctx_empty_with_loc(YagiContext* ctx, Vector2 size, const char* file, int line);
+bool yagi_ctx_button_with_loc(YagiContext* ctx, const char* label, const char* file, int line);
+bool yagi_ctx_dropdown_with_loc(YagiContext* ctx, int* already_selected, char* labels[], size_t label_count, const char* file, int line);
+bool yagi_ctx_dropdown_filtered_with_loc(YagiContext* ctx, int* already_selected, char* labels[], size_t label_count, YagiDropdownFilter* filter, const char* file, int line);
+bool yagi_ctx_input_with_loc(YagiContext* ctx, int width, InputBuffer* input_buffer, const char* file, int line);
+bool yagi_ctx_slider_with_loc(YagiContext* ctx, int width, float* value_ptr, const char* file, int line);
+bool yagi_ctx_checkbox_with_loc(YagiContext* ctx, Vector2 size, bool* checked_ptr, const char* file, int line);
+void yagi_ctx_table_with_loc(YagiContext* ctx, Vector2 size, YagiTable* table, YagiScroll* scroll, const char* file, int line);
+void yagi_ctx_stats_overlay_with_loc(YagiContext* ctx, const char* file, int line);
+
+#define yagi_id() yagi_id_with_loc(__FILE__, __LINE__)
+#define yagi_id_next() yagi_id()
 
 #define yagi_ui_begin() yagi_ui_begin_with_loc(__FILE__, __LINE__)
 #define yagi_begin_layout(type, pos, padding) yagi_begin_layout_with_loc(type, pos, padding, __FILE__, __LINE__)
 #define yagi_begin_sublayout(type, padding) yagi_begin_sublayout_with_loc(type, padding, __FILE__, __LINE__)
 #define yagi_end_layout() yagi_end_layout_with_loc(__FILE__, __LINE__)
+#define yagi_begin_scroll(size, scroll) yagi_begin_scroll_with_loc(size, scroll, __FILE__, __LINE__)
+#define yagi_end_scroll() yagi_end_scroll_with_loc(__FILE__, __LINE__)
+#define yagi_begin_container(type, size, justify, padding) yagi_begin_container_with_loc(type, size, justify, padding, __FILE__, __LINE__)
+// Variadic, so a compound literal with commas can be passed as is
+#define yagi_flex(...) yagi_flex_with_loc((__VA_ARGS__), __FILE__, __LINE__)
+#define yagi_begin_rows(row_height, row_count, first, last) yagi_begin_rows_with_loc(row_height, row_count, first, last, __FILE__, __LINE__)
+#define yagi_end_rows() yagi_end_rows_with_loc(__FILE__, __LINE__)
 #define yagi_ui_end() yagi_ui_end_with_loc(__FILE__, __LINE__)
 
 #define yagi_text(...) yagi_text_with_loc(__FILE__, __LINE__, __VA_ARGS__)
 #define yagi_empty(size) yagi_empty_with_loc(size, __FILE__, __LINE__)
 #define yagi_button(label) yagi_button_with_loc(label, __FILE__, __LINE__)
 #define yagi_dropdown(already_selected, labels, label_count) yagi_dropdown_with_loc(already_selected, labels, label_count, __FILE__, __LINE__)
+#define yagi_dropdown_filtered(already_selected, labels, label_count, filter) yagi_dropdown_filtered_with_loc(already_selected, labels, label_count, filter, __FILE__, __LINE__)
 #define yagi_input(width, input_buffer) yagi_input_with_loc(width, input_buffer, __FILE__, __LINE__)
 #define yagi_slider(width, value_ptr) yagi_slider_with_loc(width, value_ptr, __FILE__, __LINE__)
 #define yagi_checkbox(size, checked_ptr) yagi_checkbox_with_loc(size, checked_ptr, __FILE__, __LINE__)
+#define yagi_table(size, table, scroll) yagi_table_with_loc(size, table, scroll, __FILE__, __LINE__)
+#define yagi_stats_overlay() yagi_stats_overlay_with_loc(__FILE__, __LINE__)
+
+#define yagi_ctx_id(ctx) yagi_ctx_id_with_loc(ctx, __FILE__, __LINE__)
+#define yagi_ctx_ui_begin(ctx) yagi_ctx_ui_begin_with_loc(ctx, __FILE__, __LINE__)
+#define yagi_ctx_begin_layout(ctx, type, pos, padding) yagi_ctx_begin_layout_with_loc(ctx, type, pos, padding, __FILE__, __LINE__)
+#define yagi_ctx_begin_sublayout(ctx, type, padding) yagi_ctx_begin_sublayout_with_loc(ctx, type, padding, __FILE__, __LINE__)
+#define yagi_ctx_end_layout(ctx) yagi_ctx_end_layout_with_loc(ctx, __FILE__, __LINE__)
+#define yagi_ctx_next_widget_pos(ctx) yagi_ctx_next_widget_pos_with_loc(ctx, __FILE__, __LINE__)
+#define yagi_ctx_expand_layout(ctx, size) yagi_ctx_expand_layout_with_loc(ctx, size, __FILE__, __LINE__)
+#define yagi_ctx_begin_scroll(ctx, size, scroll) yagi_ctx_begin_scroll_with_loc(ctx, size, scroll, __FILE__, __LINE__)
+#define yagi_ctx_end_scroll(ctx) yagi_ctx_end_scroll_with_loc(ctx, __FILE__, __LINE__)
+#define yagi_ctx_begin_container(ctx, type, size, justify, padding) yagi_ctx_begin_container_with_loc(ctx, type, size, justify, padding, __FILE__, __LINE__)
+#define yagi_ctx_flex(ctx, ...) yagi_ctx_flex_with_loc(ctx, (__VA_ARGS__), __FILE__, __LINE__)
+#define yagi_ctx_begin_rows(ctx, row_height, row_count, first, last) yagi_ctx_begin_rows_with_loc(ctx, row_height, row_count, first, last, __FILE__, __LINE__)
+#define yagi_ctx_end_rows(ctx) yagi_ctx_end_rows_with_loc(ctx, __FILE__, __LINE__)
+#define yagi_ctx_ui_end(ctx) yagi_ctx_ui_end_with_loc(ctx, __FILE__, __LINE__)
+
+#define yagi_ctx_text(ctx, ...) yagi_ctx_text_with_loc(ctx, __FILE__, __LINE__, __VA_ARGS__)
+#define yagi_ctx_empty(ctx, size) yagi_ctx_empty_with_loc(ctx, size, __FILE__, __LINE__)
+#define yagi_ctx_button(ctx, label) yagi_ctx_button_with_loc(ctx, label, __FILE__, __LINE__)
+#define yagi_ctx_dropdown(ctx, already_selected, labels, label_count) yagi_ctx_dropdown_with_loc(ctx, already_selected, labels, label_count, __FILE__, __LINE__)
+#define yagi_ctx_dropdown_filtered(ctx, already_selected, labels, label_count, filter) yagi_ctx_dropdown_filtered_with_loc(ctx, already_selected, labels, label_count, filter, __FILE__, __LINE__)
+#define yagi_ctx_input(ctx, width, input_buffer) yagi_ctx_input_with_loc(ctx, width, input_buffer, __FILE__, __LINE__)
+#define yagi_ctx_slider(ctx, width, value_ptr) yagi_ctx_slider_with_loc(ctx, width, value_ptr, __FILE__, __LINE__)
+#define yagi_ctx_checkbox(ctx, size, checked_ptr) yagi_ctx_checkbox_with_loc(ctx, size, checked_ptr, __FILE__, __LINE__)
+#define yagi_ctx_table(ctx, size, table, scroll) yagi_ctx_table_with_loc(ctx, size, table, scroll, __FILE__, __LINE__)
+#define yagi_ctx_stats_overlay(ctx) yagi_ctx_stats_overlay_with_loc(ctx, __FILE__, __LINE__)
 
-extern YagiUi yagi_ui;
+extern _Thread_local YagiContext* yagi__current_ctx;
+// The current context of the calling thread
+#define yagi_ui (*yagi__current_ctx)
 
 #endif // YAGI_H_
 
@@ -100,41 +958,1843 @@ extern YagiUi yagi_ui;
 #include <stdlib.h>
 #include <string.h>
 
-static void yagi__input_buffer_push(InputBuffer* self, int c) {
-    if (self->count >= self->capacity) {
-        if (self->capacity == 0) self->capacity = 16;
-        while (self->count >= self->capacity) self->capacity *= 2;
-        self->codepoints = realloc(self->codepoints, sizeof(*self->codepoints) * self->capacity);
+// All of the heap memory of yagi goes through these. Define all three before including
+// the implementation to use another allocator.
+#ifndef YAGI_MALLOC
+#define YAGI_MALLOC(size) malloc(size)
+#define YAGI_REALLOC(ptr, size) realloc(ptr, size)
+#define YAGI_FREE(ptr) free(ptr)
+#endif // YAGI_MALLOC
+
+static void* yagi__calloc(size_t count, size_t size) {
+    void* ptr = YAGI_MALLOC(count * size);
+    if (ptr != NULL) memset(ptr, 0, count * size);
+    return ptr;
+}
+
+#ifndef YAGI_NO_STATS
+#include <time.h>
+
+static uint64_t yagi__now_ns() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+#define YAGI__STAT_ADD(field, value) (yagi_ui.stats.field += (value))
+#define YAGI__STAT_MAX(field, value) do { if (yagi_ui.stats.field < (value)) yagi_ui.stats.field = (value); } while (0)
+#define YAGI__STAT_WIDGET_BEGIN() uint64_t yagi__widget_start = yagi__now_ns()
+#define YAGI__STAT_WIDGET_END(kind) do { \
+        yagi_ui.stats.widgets[kind]++; \
+        yagi_ui.stats.widget_ns[kind] += yagi__now_ns() - yagi__widget_start; \
+    } while (0)
+#else
+#define YAGI__STAT_ADD(field, value) ((void)0)
+#define YAGI__STAT_MAX(field, value) ((void)0)
+#define YAGI__STAT_WIDGET_BEGIN() ((void)0)
+#define YAGI__STAT_WIDGET_END(kind) ((void)0)
+#endif // YAGI_NO_STATS
+
+static YagiContext yagi__default_ctx = {0};
+_Thread_local YagiContext* yagi__current_ctx = &yagi__default_ctx;
+
+static int yagi__glyph_index(Font font, int codepoint);
+
+static float yagi__raylib_codepoint_advance(Font font, int codepoint, float font_size) {
+    int index = yagi__glyph_index(font, codepoint);
+    float scale = font_size / font.baseSize;
+    if (font.glyphs[index].advanceX == 0) return font.recs[index].width * scale;
+    return font.glyphs[index].advanceX * scale;
+}
+
+static void yagi__raylib_draw_texture(Texture2D texture, Rectangle source, Rectangle dest, Color color) {
+    DrawTexturePro(texture, source, dest, (Vector2) { 0, 0 }, 0, color);
+}
+
+#ifndef YAGI_QUAD_BATCH
+#define YAGI_QUAD_BATCH 1024
+#endif // YAGI_QUAD_BATCH
+
+// Same vertices as DrawTexturePro without rotation, but with one rlBegin per YAGI_QUAD_BATCH quads
+static void yagi__raylib_draw_quads(Texture2D texture, const YagiQuad* quads, size_t count) {
+    float width = texture.width, height = texture.height;
+    rlSetTexture(texture.id);
+    for (size_t begin = 0; begin < count; begin += YAGI_QUAD_BATCH) {
+        size_t end = begin + YAGI_QUAD_BATCH < count ? begin + YAGI_QUAD_BATCH : count;
+        // Draws the current render batch first if the quads would not fit in it
+        rlCheckRenderBatchLimit((end - begin) * 4);
+
+        rlBegin(RL_QUADS);
+        rlNormal3f(0, 0, 1);
+        for (size_t i = begin; i < end; i++) {
+            const YagiQuad* quad = &quads[i];
+            float u0 = quad->source.x / width, u1 = (quad->source.x + quad->source.width) / width;
+            float v0 = quad->source.y / height, v1 = (quad->source.y + quad->source.height) / height;
+            float x0 = quad->dest.x, x1 = quad->dest.x + quad->dest.width;
+            float y0 = quad->dest.y, y1 = quad->dest.y + quad->dest.height;
+
+            rlColor4ub(quad->color.r, quad->color.g, quad->color.b, quad->color.a);
+            rlTexCoord2f(u0, v0);
+            rlVertex2f(x0, y0);
+            rlTexCoord2f(u0, v1);
+            rlVertex2f(x0, y1);
+            rlTexCoord2f(u1, v1);
+            rlVertex2f(x1, y1);
+            rlTexCoord2f(u1, v0);
+            rlVertex2f(x1, y0);
+        }
+        rlEnd();
+    }
+    rlSetTexture(0);
+}
+
+static void yagi__raylib_begin_clip(Rectangle rect) {
+    BeginScissorMode(rect.x, rect.y, rect.width, rect.height);
+}
+
+static void yagi__raylib_update_texture(Texture2D texture, Rectangle rect, const void* pixels) {
+    UpdateTextureRec(texture, rect, pixels);
+}
+
+static Vector2 yagi__raylib_screen_size(void) {
+    return (Vector2) { GetScreenWidth(), GetScreenHeight() };
+}
+
+static void yagi__raylib_wait_events(bool wait) {
+    if (wait) EnableEventWaiting();
+    else DisableEventWaiting();
+}
+
+static RenderTexture2D yagi__raylib_load_cache(Vector2 size) {
+    return LoadRenderTexture(size.x, size.y);
+}
+
+static void yagi__raylib_begin_cache(RenderTexture2D cache) {
+    // Premultiplied alpha, so the cached frame composites like the commands would
+    BeginTextureMode(cache);
+    ClearBackground(BLANK);
+    rlSetBlendFactorsSeparate(RL_SRC_ALPHA, RL_ONE_MINUS_SRC_ALPHA, RL_ONE, RL_ONE_MINUS_SRC_ALPHA, RL_FUNC_ADD, RL_FUNC_ADD);
+    BeginBlendMode(BLEND_CUSTOM_SEPARATE);
+}
+
+static void yagi__raylib_end_cache(void) {
+    EndBlendMode();
+    EndTextureMode();
+}
+
+static void yagi__raylib_present_cache(RenderTexture2D cache) {
+    BeginBlendMode(BLEND_ALPHA_PREMULTIPLY);
+    DrawTextureRec(cache.texture, (Rectangle) { 0, 0, cache.texture.width, -cache.texture.height }, (Vector2) { 0, 0 }, WHITE);
+    EndBlendMode();
+}
+
+const YagiBackend yagi_backend_raylib = {
+    .measure_text = MeasureTextEx,
+    .codepoint_advance = yagi__raylib_codepoint_advance,
+    .draw_rect = DrawRectangleRec,
+    .draw_border = DrawRectangleLinesEx,
+    .draw_circle = DrawCircleV,
+    .draw_text = DrawTextEx,
+    .draw_codepoints = DrawTextCodepoints,
+    .draw_texture = yagi__raylib_draw_texture,
+    .begin_clip = yagi__raylib_begin_clip,
+    .end_clip = EndScissorMode,
+    .load_texture = LoadTextureFromImage,
+    .update_texture = yagi__raylib_update_texture,
+    .unload_texture = UnloadTexture,
+    .screen_size = yagi__raylib_screen_size,
+    .mouse_position = GetMousePosition,
+    .mouse_delta = GetMouseDelta,
+    .mouse_wheel = GetMouseWheelMoveV,
+    .is_mouse_down = IsMouseButtonDown,
+    .is_mouse_pressed = IsMouseButtonPressed,
+    .is_mouse_released = IsMouseButtonReleased,
+    .is_key_down = IsKeyDown,
+    .is_key_pressed = IsKeyPressed,
+    .is_key_pressed_repeat = IsKeyPressedRepeat,
+    .is_key_released = IsKeyReleased,
+    .char_pressed = GetCharPressed,
+    .get_clipboard = GetClipboardText,
+    .set_clipboard = SetClipboardText,
+    .wait_events = yagi__raylib_wait_events,
+    .frame_time = GetFrameTime,
+    .draw_quads = yagi__raylib_draw_quads,
+    .load_cache = yagi__raylib_load_cache,
+    .unload_cache = UnloadRenderTexture,
+    .begin_cache = yagi__raylib_begin_cache,
+    .end_cache = yagi__raylib_end_cache,
+    .present_cache = yagi__raylib_present_cache,
+};
+
+YagiHeadless yagi_headless = { .screen_size = { 1280, 720 } };
+
+static YagiHeadlessCall* yagi__headless_push(YagiHeadlessCallKind kind, Rectangle rect, float size, Color color) {
+    if (yagi_headless.call_count >= yagi_headless.call_capacity) {
+        if (yagi_headless.call_capacity == 0) yagi_headless.call_capacity = 256;
+        while (yagi_headless.call_count >= yagi_headless.call_capacity) yagi_headless.call_capacity *= 2;
+        yagi_headless.calls = YAGI_REALLOC(yagi_headless.calls, sizeof(*yagi_headless.calls) * yagi_headless.call_capacity);
+        assert(yagi_headless.calls != NULL);
+    }
+
+    YagiHeadlessCall* call = &yagi_headless.calls[yagi_headless.call_count++];
+    *call = (YagiHeadlessCall) { .kind = kind, .rect = rect, .size = size, .color = color };
+    return call;
+}
+
+static void yagi__headless_append_text(const char* text, size_t len) {
+    if (yagi_headless.text_count + len > yagi_headless.text_capacity) {
+        if (yagi_headless.text_capacity == 0) yagi_headless.text_capacity = 4096;
+        while (yagi_headless.text_count + len > yagi_headless.text_capacity) yagi_headless.text_capacity *= 2;
+        yagi_headless.text = YAGI_REALLOC(yagi_headless.text, yagi_headless.text_capacity);
+        assert(yagi_headless.text != NULL);
+    }
+
+    memcpy(yagi_headless.text + yagi_headless.text_count, text, len);
+    yagi_headless.text_count += len;
+}
+
+static Vector2 yagi__headless_measure_text(Font font, const char* text, float font_size, float font_spacing) {
+    (void)font;
+    float line_width = 0, width = 0, height = font_size;
+    int glyphs = 0;
+
+    while (*text != 0) {
+        int codepoint_size = 0;
+        int codepoint = GetCodepointNext(text, &codepoint_size);
+        text += codepoint_size;
+
+        if (codepoint == '\n') {
+            if (width < line_width) width = line_width;
+            line_width = 0;
+            glyphs = 0;
+            height += font_size + 2;
+            continue;
+        }
+
+        if (glyphs > 0) line_width += font_spacing;
+        line_width += font_size * YAGI_HEADLESS_GLYPH_WIDTH;
+        glyphs++;
+    }
+
+    if (width < line_width) width = line_width;
+    return (Vector2) { width, height };
+}
+
+static float yagi__headless_codepoint_advance(Font font, int codepoint, float font_size) {
+    (void)font;
+    (void)codepoint;
+    return font_size * YAGI_HEADLESS_GLYPH_WIDTH;
+}
+
+static void yagi__headless_draw_rect(Rectangle rect, Color color) {
+    yagi__headless_push(YAGI_HEADLESS_RECT, rect, 0, color);
+}
+
+static void yagi__headless_draw_border(Rectangle rect, float thickness, Color color) {
+    yagi__headless_push(YAGI_HEADLESS_BORDER, rect, thickness, color);
+}
+
+static void yagi__headless_draw_circle(Vector2 center, float radius, Color color) {
+    yagi__headless_push(YAGI_HEADLESS_CIRCLE, (Rectangle) { center.x, center.y, 0, 0 }, radius, color);
+}
+
+static void yagi__headless_draw_text(Font font, const char* text, Vector2 pos, float font_size, float font_spacing, Color color) {
+    Vector2 size = yagi__headless_measure_text(font, text, font_size, font_spacing);
+    YagiHeadlessCall* call = yagi__headless_push(YAGI_HEADLESS_TEXT, (Rectangle) { pos.x, pos.y, size.x, size.y }, font_size, color);
+    call->text = yagi_headless.text_count;
+    call->text_count = strlen(text);
+    yagi__headless_append_text(text, call->text_count);
+}
+
+static void yagi__headless_draw_codepoints(Font font, const int* codepoints, int count, Vector2 pos, float font_size, float font_spacing, Color color) {
+    (void)font;
+    float width = count * font_size * YAGI_HEADLESS_GLYPH_WIDTH + (count > 0 ? (count - 1) * font_spacing : 0);
+    YagiHeadlessCall* call = yagi__headless_push(YAGI_HEADLESS_TEXT, (Rectangle) { pos.x, pos.y, width, font_size }, font_size, color);
+    call->text = yagi_headless.text_count;
+    for (int i = 0; i < count; i++) {
+        int size = 0;
+        const char* bytes = CodepointToUTF8(codepoints[i], &size);
+        yagi__headless_append_text(bytes, size);
     }
-    self->codepoints[self->count++] = c;
+    call->text_count = yagi_headless.text_count - call->text;
+}
+
+static void yagi__headless_draw_texture(Texture2D texture, Rectangle source, Rectangle dest, Color color) {
+    (void)texture;
+    (void)source;
+    yagi__headless_push(YAGI_HEADLESS_TEXTURE, dest, 0, color);
+}
+
+static void yagi__headless_begin_clip(Rectangle rect) {
+    yagi__headless_push(YAGI_HEADLESS_CLIP, rect, 0, BLANK);
+}
+
+static void yagi__headless_end_clip(void) {
+    yagi__headless_push(YAGI_HEADLESS_CLIP, (Rectangle) {0}, 0, BLANK);
+}
+
+static Texture2D yagi__headless_load_texture(Image image) {
+    static unsigned int next_id = 0;
+    return (Texture2D) { ++next_id, image.width, image.height, 1, image.format };
+}
+
+static void yagi__headless_update_texture(Texture2D texture, Rectangle rect, const void* pixels) {
+    (void)texture;
+    (void)rect;
+    (void)pixels;
+}
+
+static void yagi__headless_unload_texture(Texture2D texture) {
+    (void)texture;
+}
+
+static RenderTexture2D yagi__headless_load_cache(Vector2 size) {
+    Texture2D texture = yagi__headless_load_texture((Image) { .width = size.x, .height = size.y });
+    return (RenderTexture2D) { .id = texture.id, .texture = texture };
+}
+
+static void yagi__headless_unload_cache(RenderTexture2D cache) {
+    (void)cache;
+}
+
+static void yagi__headless_begin_cache(RenderTexture2D cache) {
+    (void)cache;
+}
+
+static void yagi__headless_end_cache(void) {
+}
+
+static void yagi__headless_present_cache(RenderTexture2D cache) {
+    yagi__headless_push(YAGI_HEADLESS_PRESENT, (Rectangle) { 0, 0, cache.texture.width, cache.texture.height }, 0, WHITE);
+}
+
+static Vector2 yagi__headless_screen_size(void) {
+    return yagi_headless.screen_size;
+}
+
+static Vector2 yagi__headless_mouse_position(void) {
+    return yagi_headless.mouse;
+}
+
+static Vector2 yagi__headless_mouse_delta(void) {
+    return (Vector2) { yagi_headless.mouse.x - yagi_headless.previous_mouse.x, yagi_headless.mouse.y - yagi_headless.previous_mouse.y };
+}
+
+static Vector2 yagi__headless_mouse_wheel(void) {
+    return yagi_headless.wheel;
+}
+
+static bool yagi__headless_is_mouse_down(int button) {
+    return button >= 0 && button < 3 && yagi_headless.mouse_down[button];
+}
+
+static bool yagi__headless_is_mouse_pressed(int button) {
+    return button >= 0 && button < 3 && yagi_headless.mouse_down[button] && !yagi_headless.previous_mouse_down[button];
+}
+
+static bool yagi__headless_is_mouse_released(int button) {
+    return button >= 0 && button < 3 && !yagi_headless.mouse_down[button] && yagi_headless.previous_mouse_down[button];
+}
+
+static bool yagi__headless_is_key_down(int key) {
+    return key >= 0 && key < 512 && yagi_headless.key_down[key];
+}
+
+static bool yagi__headless_is_key_pressed(int key) {
+    return key >= 0 && key < 512 && yagi_headless.key_down[key] && !yagi_headless.previous_key_down[key];
+}
+
+static bool yagi__headless_is_key_pressed_repeat(int key) {
+    return key >= 0 && key < 512 && yagi_headless.key_repeat[key];
+}
+
+static bool yagi__headless_is_key_released(int key) {
+    return key >= 0 && key < 512 && !yagi_headless.key_down[key] && yagi_headless.previous_key_down[key];
+}
+
+static int yagi__headless_char_pressed(void) {
+    if (yagi_headless.char_read >= yagi_headless.char_count) return 0;
+    return yagi_headless.chars[yagi_headless.char_read++];
+}
+
+static const char* yagi__headless_get_clipboard(void) {
+    return yagi_headless.clipboard;
+}
+
+static void yagi__headless_begin_frame(void) {
+    yagi_headless.call_count = 0;
+    yagi_headless.text_count = 0;
+}
+
+// The input of a frame is consumed by it, what stays held is only "down" in the next one
+static void yagi__headless_end_frame(void) {
+    yagi_headless.previous_mouse = yagi_headless.mouse;
+    yagi_headless.wheel = (Vector2) {0};
+    memcpy(yagi_headless.previous_mouse_down, yagi_headless.mouse_down, sizeof(yagi_headless.mouse_down));
+    memcpy(yagi_headless.previous_key_down, yagi_headless.key_down, sizeof(yagi_headless.key_down));
+    memset(yagi_headless.key_repeat, 0, sizeof(yagi_headless.key_repeat));
+    yagi_headless.char_count = 0;
+    yagi_headless.char_read = 0;
 }
 
-static char yagi_utf8_temp_buf[1024] = {0};
-char* yagi_utf8_temp(int* codepoints, int codepoints_count) {
-    char* utf8 = LoadUTF8(codepoints, codepoints_count);
-    strcpy(yagi_utf8_temp_buf, utf8);
-    UnloadUTF8(utf8);
-    return yagi_utf8_temp_buf;
-}
+const YagiBackend yagi_backend_headless = {
+    .measure_text = yagi__headless_measure_text,
+    .codepoint_advance = yagi__headless_codepoint_advance,
+    .draw_rect = yagi__headless_draw_rect,
+    .draw_border = yagi__headless_draw_border,
+    .draw_circle = yagi__headless_draw_circle,
+    .draw_text = yagi__headless_draw_text,
+    .draw_codepoints = yagi__headless_draw_codepoints,
+    .draw_texture = yagi__headless_draw_texture,
+    .begin_clip = yagi__headless_begin_clip,
+    .end_clip = yagi__headless_end_clip,
+    .load_texture = yagi__headless_load_texture,
+    .update_texture = yagi__headless_update_texture,
+    .unload_texture = yagi__headless_unload_texture,
+    .screen_size = yagi__headless_screen_size,
+    .mouse_position = yagi__headless_mouse_position,
+    .mouse_delta = yagi__headless_mouse_delta,
+    .mouse_wheel = yagi__headless_mouse_wheel,
+    .is_mouse_down = yagi__headless_is_mouse_down,
+    .is_mouse_pressed = yagi__headless_is_mouse_pressed,
+    .is_mouse_released = yagi__headless_is_mouse_released,
+    .is_key_down = yagi__headless_is_key_down,
+    .is_key_pressed = yagi__headless_is_key_pressed,
+    .is_key_pressed_repeat = yagi__headless_is_key_pressed_repeat,
+    .is_key_released = yagi__headless_is_key_released,
+    .char_pressed = yagi__headless_char_pressed,
+    .get_clipboard = yagi__headless_get_clipboard,
+    .set_clipboard = yagi_headless_set_clipboard,
+    .begin_frame = yagi__headless_begin_frame,
+    .end_frame = yagi__headless_end_frame,
+    .load_cache = yagi__headless_load_cache,
+    .unload_cache = yagi__headless_unload_cache,
+    .begin_cache = yagi__headless_begin_cache,
+    .end_cache = yagi__headless_end_cache,
+    .present_cache = yagi__headless_present_cache,
+};
+
+void yagi_headless_set_screen_size(Vector2 size) {
+    yagi_headless.screen_size = size;
+}
+
+void yagi_headless_set_mouse(Vector2 pos) {
+    yagi_headless.mouse = pos;
+}
+
+void yagi_headless_set_mouse_button(int button, bool down) {
+    if (button >= 0 && button < 3) yagi_headless.mouse_down[button] = down;
+}
+
+void yagi_headless_set_key(int key, bool down) {
+    if (key >= 0 && key < 512) yagi_headless.key_down[key] = down;
+}
+
+void yagi_headless_repeat_key(int key) {
+    if (key >= 0 && key < 512 && yagi_headless.key_down[key]) yagi_headless.key_repeat[key] = true;
+}
+
+void yagi_headless_scroll(Vector2 wheel) {
+    yagi_headless.wheel.x += wheel.x;
+    yagi_headless.wheel.y += wheel.y;
+}
+
+void yagi_headless_type(const char* text) {
+    while (*text != 0 && yagi_headless.char_count < YAGI_HEADLESS_CHAR_MAX_COUNT) {
+        int size = 0;
+        yagi_headless.chars[yagi_headless.char_count++] = GetCodepointNext(text, &size);
+        text += size;
+    }
+}
+
+void yagi_headless_set_clipboard(const char* text) {
+    YAGI_FREE(yagi_headless.clipboard);
+    yagi_headless.clipboard = NULL;
+    if (text == NULL) return;
+
+    size_t len = strlen(text);
+    yagi_headless.clipboard = YAGI_MALLOC(len + 1);
+    assert(yagi_headless.clipboard != NULL);
+    memcpy(yagi_headless.clipboard, text, len + 1);
+}
+
+void yagi_headless_free() {
+    YAGI_FREE(yagi_headless.calls);
+    YAGI_FREE(yagi_headless.text);
+    YAGI_FREE(yagi_headless.clipboard);
+    yagi_headless = (YagiHeadless) { .screen_size = yagi_headless.screen_size };
+}
+
+static const YagiBackend* yagi__backend() {
+    return yagi_ui.backend != NULL ? yagi_ui.backend : &yagi_backend_raylib;
+}
+
+void yagi_ui_set_backend(const YagiBackend* backend) {
+    // The cached frame belongs to the previous backend
+    if (yagi_ui.frame_cache.id != 0) yagi__backend()->unload_cache(yagi_ui.frame_cache);
+    yagi_ui.frame_cache = (RenderTexture2D) {0};
+    yagi_ui.frame_cached = false;
+    yagi_ui.backend = backend;
+}
+
+static bool yagi__bit(const uint8_t* bits, int index) {
+    return (bits[index / 8] >> (index % 8)) & 1;
+}
+
+static void yagi__set_bit(uint8_t* bits, int index) {
+    bits[index / 8] |= 1 << (index % 8);
+}
+
+// Input log format, in native byte order: YAGI__LOG_MAGIC, then for every frame
+//     f32 frame_time, f32 screen_size, mouse, mouse_delta and wheel (x and y each)
+//     u8 mouse_down, mouse_pressed, mouse_released
+//     u16 key count, then per key with any state: u16 key, u8 YAGI__LOG_KEY_* flags
+//     u16 char count, then i32 codepoints
+//     u32 clipboard length (YAGI__LOG_NO_CLIPBOARD if it was not read), then its bytes
+#define YAGI__LOG_MAGIC "YAGIIN03"
+#define YAGI__LOG_KEY_DOWN 1
+#define YAGI__LOG_KEY_PRESSED 2
+#define YAGI__LOG_KEY_REPEAT 4
+#define YAGI__LOG_KEY_RELEASED 8
+#define YAGI__LOG_NO_CLIPBOARD UINT32_MAX
+
+static void yagi__log_clipboard_set(const char* text, size_t len) {
+    if (len + 1 > yagi_ui.log_clipboard_capacity) {
+        yagi_ui.log_clipboard_capacity = len + 1;
+        yagi_ui.log_clipboard = YAGI_REALLOC(yagi_ui.log_clipboard, yagi_ui.log_clipboard_capacity);
+        assert(yagi_ui.log_clipboard != NULL);
+    }
+    memcpy(yagi_ui.log_clipboard, text, len);
+    yagi_ui.log_clipboard[len] = 0;
+    yagi_ui.log_clipboard_set = true;
+}
+
+static void yagi__log_write_frame(FILE* file, const YagiInput* input) {
+    float floats[] = {
+        input->frame_time, input->screen_size.x, input->screen_size.y, input->mouse.x, input->mouse.y,
+        input->mouse_delta.x, input->mouse_delta.y, input->wheel.x, input->wheel.y,
+    };
+    fwrite(floats, sizeof(floats), 1, file);
+    uint8_t buttons[] = { input->mouse_down, input->mouse_pressed, input->mouse_released };
+    fwrite(buttons, sizeof(buttons), 1, file);
+
+    uint16_t key_count = 0;
+    for (int key = 0; key < YAGI_INPUT_KEY_COUNT; key++) {
+        key_count += yagi__bit(input->key_down, key) || yagi__bit(input->key_released, key);
+    }
+    fwrite(&key_count, sizeof(key_count), 1, file);
+    for (int key = 0; key < YAGI_INPUT_KEY_COUNT; key++) {
+        uint8_t flags = (yagi__bit(input->key_down, key) ? YAGI__LOG_KEY_DOWN : 0)
+            | (yagi__bit(input->key_pressed, key) ? YAGI__LOG_KEY_PRESSED : 0)
+            | (yagi__bit(input->key_repeat, key) ? YAGI__LOG_KEY_REPEAT : 0)
+            | (yagi__bit(input->key_released, key) ? YAGI__LOG_KEY_RELEASED : 0);
+        if (flags == 0) continue;
+        uint16_t key16 = key;
+        fwrite(&key16, sizeof(key16), 1, file);
+        fwrite(&flags, sizeof(flags), 1, file);
+    }
+
+    uint16_t char_count = input->char_count;
+    fwrite(&char_count, sizeof(char_count), 1, file);
+    for (size_t i = 0; i < input->char_count; i++) {
+        int32_t codepoint = input->chars[i];
+        fwrite(&codepoint, sizeof(codepoint), 1, file);
+    }
+
+    uint32_t clipboard_len = yagi_ui.log_clipboard_set ? strlen(yagi_ui.log_clipboard) : YAGI__LOG_NO_CLIPBOARD;
+    fwrite(&clipboard_len, sizeof(clipboard_len), 1, file);
+    if (yagi_ui.log_clipboard_set) fwrite(yagi_ui.log_clipboard, 1, clipboard_len, file);
+}
+
+// Returns false at the end of the log, or if the frame is cut short
+static bool yagi__log_read_frame(FILE* file, YagiInput* input) {
+    *input = (YagiInput) {0};
+    float floats[9];
+    uint8_t buttons[3];
+    uint16_t key_count;
+    if (fread(floats, sizeof(floats), 1, file) != 1) return false;
+    if (fread(buttons, sizeof(buttons), 1, file) != 1) return false;
+    if (fread(&key_count, sizeof(key_count), 1, file) != 1) return false;
+
+    input->frame_time = floats[0];
+    input->screen_size = (Vector2) { floats[1], floats[2] };
+    input->mouse = (Vector2) { floats[3], floats[4] };
+    input->mouse_delta = (Vector2) { floats[5], floats[6] };
+    input->wheel = (Vector2) { floats[7], floats[8] };
+    input->mouse_down = buttons[0];
+    input->mouse_pressed = buttons[1];
+    input->mouse_released = buttons[2];
+
+    for (uint16_t i = 0; i < key_count; i++) {
+        uint16_t key;
+        uint8_t flags;
+        if (fread(&key, sizeof(key), 1, file) != 1 || fread(&flags, sizeof(flags), 1, file) != 1) return false;
+        if (key >= YAGI_INPUT_KEY_COUNT) continue;
+        if (flags & YAGI__LOG_KEY_DOWN) yagi__set_bit(input->key_down, key);
+        if (flags & YAGI__LOG_KEY_PRESSED) yagi__set_bit(input->key_pressed, key);
+        if (flags & YAGI__LOG_KEY_REPEAT) yagi__set_bit(input->key_repeat, key);
+        if (flags & YAGI__LOG_KEY_RELEASED) yagi__set_bit(input->key_released, key);
+    }
+
+    uint16_t char_count;
+    if (fread(&char_count, sizeof(char_count), 1, file) != 1) return false;
+    for (uint16_t i = 0; i < char_count; i++) {
+        int32_t codepoint;
+        if (fread(&codepoint, sizeof(codepoint), 1, file) != 1) return false;
+        if (input->char_count < YAGI_INPUT_CHAR_MAX_COUNT) input->chars[input->char_count++] = codepoint;
+    }
+
+    uint32_t clipboard_len;
+    if (fread(&clipboard_len, sizeof(clipboard_len), 1, file) != 1) return false;
+    yagi_ui.log_clipboard_set = false;
+    if (clipboard_len != YAGI__LOG_NO_CLIPBOARD) {
+        if (clipboard_len + 1 > yagi_ui.log_clipboard_capacity) {
+            yagi_ui.log_clipboard_capacity = clipboard_len + 1;
+            yagi_ui.log_clipboard = YAGI_REALLOC(yagi_ui.log_clipboard, yagi_ui.log_clipboard_capacity);
+            assert(yagi_ui.log_clipboard != NULL);
+        }
+        if (fread(yagi_ui.log_clipboard, 1, clipboard_len, file) != clipboard_len) return false;
+        yagi_ui.log_clipboard[clipboard_len] = 0;
+        yagi_ui.log_clipboard_set = true;
+    }
+    return true;
+}
+
+// Clipboard text for pasting. Reads are logged while recording and come from the log while
+// replaying, or from the snapshot the input of the frame came from.
+static const char* yagi__clipboard() {
+    if (yagi_ui.replay_file != NULL || yagi_ui.input_given) return yagi_ui.log_clipboard_set ? yagi_ui.log_clipboard : NULL;
+
+    const char* text = yagi__backend()->get_clipboard();
+    if (yagi_ui.record_file != NULL && text != NULL) yagi__log_clipboard_set(text, strlen(text));
+    return text;
+}
+
+static void yagi__input_read_backend(const YagiBackend* backend, YagiInput* input) {
+    *input = (YagiInput) {
+        .frame_time = backend->frame_time != NULL ? backend->frame_time() : 0,
+        .screen_size = backend->screen_size(),
+        .mouse = backend->mouse_position(),
+        .mouse_delta = backend->mouse_delta(),
+        .wheel = backend->mouse_wheel(),
+    };
+
+    for (int button = 0; button < YAGI_INPUT_BUTTON_COUNT; button++) {
+        if (backend->is_mouse_down(button)) input->mouse_down |= 1 << button;
+        if (backend->is_mouse_pressed(button)) input->mouse_pressed |= 1 << button;
+        if (backend->is_mouse_released(button)) input->mouse_released |= 1 << button;
+    }
+
+    // A key can only be pressed or repeated while it is down, and only released while it is up
+    for (int key = 0; key < YAGI_INPUT_KEY_COUNT; key++) {
+        if (backend->is_key_down(key)) {
+            yagi__set_bit(input->key_down, key);
+            if (backend->is_key_pressed(key)) yagi__set_bit(input->key_pressed, key);
+            if (backend->is_key_pressed_repeat(key)) yagi__set_bit(input->key_repeat, key);
+        } else if (backend->is_key_released(key)) {
+            yagi__set_bit(input->key_released, key);
+        }
+    }
+
+    for (int codepoint = backend->char_pressed(); codepoint > 0; codepoint = backend->char_pressed()) {
+        if (input->char_count < YAGI_INPUT_CHAR_MAX_COUNT) input->chars[input->char_count++] = codepoint;
+    }
+}
+
+// Reads the whole input of the frame, draining the character queue of the backend. Deferred
+// contexts only take the input they were given.
+static void yagi__input_read(YagiInput* input) {
+    yagi_ui.input_given = false;
+    yagi_ui.input_replayed = false;
+    if (yagi_ui.next_input_set && yagi_ui.replay_file == NULL) {
+        // The clipboard of the snapshot is already set
+        *input = yagi_ui.next_input;
+        yagi_ui.next_input_set = false;
+        yagi_ui.input_given = true;
+        return;
+    }
+    yagi_ui.next_input_set = false;
+
+    yagi_ui.log_clipboard_set = false;
+    if (yagi_ui.replay_file != NULL) {
+        bool read = yagi__log_read_frame(yagi_ui.replay_file, input);
+        // Done with the last frame of the log, so a replay loop runs exactly the logged frames
+        int next = read ? getc(yagi_ui.replay_file) : EOF;
+        if (next != EOF) {
+            ungetc(next, yagi_ui.replay_file);
+        } else {
+            fclose(yagi_ui.replay_file);
+            yagi_ui.replay_file = NULL;
+            yagi_ui.replay_done = true;
+        }
+        if (read) {
+            yagi_ui.input_replayed = true;
+            return;
+        }
+        yagi_ui.log_clipboard_set = false;
+    }
+
+    if (yagi_ui.deferred) {
+        *input = (YagiInput) {0};
+        return;
+    }
+    yagi__input_read_backend(yagi__backend(), input);
+}
+
+void yagi_input_snapshot(YagiInputSnapshot* snapshot) {
+    const YagiBackend* backend = yagi__backend();
+    yagi__input_read_backend(backend, &snapshot->input);
+
+    // Only read when an input widget could paste, the clipboard can be slow to get
+    snapshot->clipboard_set = false;
+    bool ctrl = yagi__bit(snapshot->input.key_down, KEY_LEFT_CONTROL) || yagi__bit(snapshot->input.key_down, KEY_RIGHT_CONTROL);
+    bool paste = yagi__bit(snapshot->input.key_pressed, KEY_V) || yagi__bit(snapshot->input.key_repeat, KEY_V);
+    const char* text = ctrl && paste ? backend->get_clipboard() : NULL;
+    if (text != NULL) {
+        size_t len = strlen(text);
+        if (len + 1 > snapshot->clipboard_capacity) {
+            snapshot->clipboard_capacity = len + 1;
+            snapshot->clipboard = YAGI_REALLOC(snapshot->clipboard, snapshot->clipboard_capacity);
+            assert(snapshot->clipboard != NULL);
+        }
+        memcpy(snapshot->clipboard, text, len + 1);
+        snapshot->clipboard_set = true;
+    }
+}
+
+void yagi_input_snapshot_free(YagiInputSnapshot* snapshot) {
+    YAGI_FREE(snapshot->clipboard);
+    *snapshot = (YagiInputSnapshot) {0};
+}
+
+static bool yagi__input_any(const YagiInput* input) {
+    if (input->mouse_delta.x != 0 || input->mouse_delta.y != 0 || input->wheel.x != 0 || input->wheel.y != 0) return true;
+    if (input->mouse_down != 0 || input->mouse_released != 0 || input->char_count > 0) return true;
+    for (size_t i = 0; i < sizeof(input->key_down); i++) {
+        if (input->key_down[i] != 0 || input->key_released[i] != 0) return true;
+    }
+    return false;
+}
+
+static bool yagi__mouse_down(int button) {
+    return (yagi_ui.input.mouse_down >> button) & 1;
+}
+
+static bool yagi__mouse_pressed(int button) {
+    return (yagi_ui.input.mouse_pressed >> button) & 1;
+}
+
+static bool yagi__mouse_released(int button) {
+    return (yagi_ui.input.mouse_released >> button) & 1;
+}
+
+static bool yagi__key_down(int key) {
+    return key >= 0 && key < YAGI_INPUT_KEY_COUNT && yagi__bit(yagi_ui.input.key_down, key);
+}
+
+// First press of key only
+static bool yagi__key_pressed_once(int key) {
+    return key >= 0 && key < YAGI_INPUT_KEY_COUNT && yagi__bit(yagi_ui.input.key_pressed, key);
+}
+
+// Press or key repeat
+static bool yagi__key_pressed(int key) {
+    return yagi__key_pressed_once(key) || (key >= 0 && key < YAGI_INPUT_KEY_COUNT && yagi__bit(yagi_ui.input.key_repeat, key));
+}
+
+const YagiInput* yagi_ui_input() {
+    return &yagi_ui.input;
+}
+
+bool yagi_ui_record_input(const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) return false;
+    fwrite(YAGI__LOG_MAGIC, 1, strlen(YAGI__LOG_MAGIC), file);
+
+    if (yagi_ui.record_file != NULL) fclose(yagi_ui.record_file);
+    yagi_ui.record_file = file;
+    return true;
+}
+
+bool yagi_ui_replay_input(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) return false;
+
+    char magic[sizeof(YAGI__LOG_MAGIC) - 1];
+    if (fread(magic, sizeof(magic), 1, file) != 1 || memcmp(magic, YAGI__LOG_MAGIC, sizeof(magic)) != 0) {
+        fclose(file);
+        return false;
+    }
+
+    if (yagi_ui.replay_file != NULL) fclose(yagi_ui.replay_file);
+    yagi_ui.replay_file = file;
+    yagi_ui.replay_done = false;
+    return true;
+}
+
+bool yagi_ui_replay_done() {
+    return yagi_ui.replay_done;
+}
+
+void yagi_ui_close_input_log() {
+    if (yagi_ui.record_file != NULL) fclose(yagi_ui.record_file);
+    if (yagi_ui.replay_file != NULL) fclose(yagi_ui.replay_file);
+    yagi_ui.record_file = NULL;
+    yagi_ui.replay_file = NULL;
+}
+
+bool yagi_ui_input_log_args(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            if (!yagi_ui_record_input(argv[++i])) {
+                fprintf(stderr, "Failed to create input log: %s\n", argv[i]);
+                return false;
+            }
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            if (!yagi_ui_replay_input(argv[++i])) {
+                fprintf(stderr, "Failed to open input log: %s\n", argv[i]);
+                return false;
+            }
+        } else {
+            fprintf(stderr, "Usage: %s [--record FILE | --replay FILE]\n", argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifndef YAGI_ARENA_CHUNK_SIZE
+#define YAGI_ARENA_CHUNK_SIZE (64 * 1024)
+#endif // YAGI_ARENA_CHUNK_SIZE
+
+static void* yagi__arena_alloc(YagiArena* arena, size_t size) {
+    size = (size + 15) & ~(size_t)15;
+
+    YagiArenaChunk* chunk = arena->current;
+    while (chunk != NULL && chunk->used + size > chunk->capacity) {
+        chunk = chunk->next;
+    }
+
+    if (chunk == NULL) {
+        size_t capacity = size > YAGI_ARENA_CHUNK_SIZE ? size : YAGI_ARENA_CHUNK_SIZE;
+        chunk = YAGI_MALLOC(sizeof(*chunk) + capacity);
+        assert(chunk != NULL);
+        *chunk = (YagiArenaChunk) { .capacity = capacity };
+
+        if (arena->current == NULL) {
+            arena->first = chunk;
+        } else {
+            // Keep the chunks after current, they are still free
+            YagiArenaChunk* last = arena->current;
+            while (last->next != NULL) last = last->next;
+            last->next = chunk;
+        }
+    }
+
+    arena->current = chunk;
+    void* ptr = chunk->data + chunk->used;
+    chunk->used += size;
+    return ptr;
+}
+
+static void yagi__arena_reset(YagiArena* arena) {
+    for (YagiArenaChunk* chunk = arena->first; chunk != NULL; chunk = chunk->next) {
+        chunk->used = 0;
+    }
+    arena->current = arena->first;
+}
+
+static void yagi__arena_free(YagiArena* arena) {
+    YagiArenaChunk* chunk = arena->first;
+    while (chunk != NULL) {
+        YagiArenaChunk* next = chunk->next;
+        YAGI_FREE(chunk);
+        chunk = next;
+    }
+    *arena = (YagiArena) {0};
+}
+
+void* yagi_frame_alloc(size_t size) {
+    return yagi__arena_alloc(&yagi_ui.frame_arena, size);
+}
+
+char* yagi_frame_vprintf(const char* fmt, va_list args) {
+    YagiArenaChunk* chunk = yagi_ui.frame_arena.current;
+    size_t available = chunk != NULL ? chunk->capacity - chunk->used : 0;
+    char* buffer = chunk != NULL ? (char*)chunk->data + chunk->used : NULL;
+
+    // Try to format straight into the free space of the current chunk first
+    va_list copy;
+    va_copy(copy, args);
+    int len = vsnprintf(buffer, available, fmt, copy);
+    va_end(copy);
+    assert(len >= 0);
+
+    YAGI__STAT_ADD(bytes_formatted, len);
+    if ((size_t)len < available) return yagi_frame_alloc(len + 1);
+
+    buffer = yagi_frame_alloc(len + 1);
+    vsnprintf(buffer, len + 1, fmt, args);
+    return buffer;
+}
+
+char* yagi_frame_printf(const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    char* str = yagi_frame_vprintf(fmt, args);
+    va_end(args);
+    return str;
+}
+
+char* yagi_utf8_temp(int* codepoints, int codepoints_count) {
+    size_t len = 0;
+    for (int i = 0; i < codepoints_count; i++) {
+        int size = 0;
+        CodepointToUTF8(codepoints[i], &size);
+        len += size;
+    }
+
+    char* utf8 = yagi_frame_alloc(len + 1);
+    len = 0;
+    for (int i = 0; i < codepoints_count; i++) {
+        int size = 0;
+        const char* bytes = CodepointToUTF8(codepoints[i], &size);
+        memcpy(utf8 + len, bytes, size);
+        len += size;
+    }
+    utf8[len] = 0;
+    return utf8;
+}
+
+// Fonts can be loaded from any thread
+static _Atomic unsigned int yagi__font_next_id;
+
+YagiFont* yagi_font_load(const char* path) {
+    int file_size = 0;
+    unsigned char* file_data = LoadFileData(path, &file_size);
+    if (file_data == NULL) {
+        fprintf(stderr, "[YAGI] Failed to load font %s\n", path);
+        return NULL;
+    }
+
+    YagiFont* font = yagi__calloc(1, sizeof(*font));
+    assert(font != NULL);
+    // Keep the ids away from texture ids, they share the measurement cache keys
+    font->id = 0x80000000u | (atomic_fetch_add(&yagi__font_next_id, 1) + 1);
+    font->file_data = file_data;
+    font->file_size = file_size;
+    atomic_flag_clear(&font->lock);
+    return font;
+}
+
+void yagi_font_unload(YagiFont* font) {
+    if (font == NULL) return;
+
+    for (size_t i = 0; i < font->page_count; i++) {
+        if (font->pages[i].texture.id != 0) yagi__backend()->unload_texture(font->pages[i].texture);
+        YAGI_FREE(font->pages[i].pixels);
+    }
+    for (size_t i = 0; i < font->size_count; i++) {
+        YAGI_FREE(font->sizes[i].glyphs);
+    }
+    YAGI_FREE(font->sizes);
+    UnloadFileData(font->file_data);
+    YAGI_FREE(font);
+}
+
+static YagiFontSize* yagi__font_size(YagiFont* font, int pixel_size) {
+    for (size_t i = 0; i < font->size_count; i++) {
+        if (font->sizes[i].pixel_size == pixel_size) return &font->sizes[i];
+    }
+
+    if (font->size_count >= font->size_capacity) {
+        font->size_capacity = font->size_capacity == 0 ? 4 : font->size_capacity * 2;
+        font->sizes = YAGI_REALLOC(font->sizes, sizeof(*font->sizes) * font->size_capacity);
+        assert(font->sizes != NULL);
+    }
+    font->sizes[font->size_count] = (YagiFontSize) { .pixel_size = pixel_size };
+    return &font->sizes[font->size_count++];
+}
+
+static YagiGlyph* yagi__font_size_slot(YagiFontSize* size, int codepoint) {
+    size_t mask = size->glyph_capacity - 1;
+    size_t i = ((uint32_t)codepoint * 2654435761u) & mask;
+    while (size->glyphs[i].codepoint != -1 && size->glyphs[i].codepoint != codepoint) {
+        i = (i + 1) & mask;
+    }
+    return &size->glyphs[i];
+}
+
+static void yagi__font_size_grow(YagiFontSize* size) {
+    YagiGlyph* old = size->glyphs;
+    size_t old_capacity = size->glyph_capacity;
+
+    size->glyph_capacity = old_capacity == 0 ? 256 : old_capacity * 2;
+    size->glyphs = YAGI_MALLOC(sizeof(*size->glyphs) * size->glyph_capacity);
+    assert(size->glyphs != NULL);
+    memset(size->glyphs, 0xff, sizeof(*size->glyphs) * size->glyph_capacity);
+
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old[i].codepoint != -1) *yagi__font_size_slot(size, old[i].codepoint) = old[i];
+    }
+    YAGI_FREE(old);
+}
+
+// Finds room for a w*h box on a page of the given pixel size, evicting the least
+// recently used page if all pages are full. Returns the page index or -1.
+static int yagi__font_pack(YagiFont* font, int pixel_size, int w, int h, int* x, int* y) {
+    for (size_t i = 0; i < font->page_count; i++) {
+        YagiGlyphPage* page = &font->pages[i];
+        if (page->pixel_size != pixel_size) continue;
+
+        for (size_t j = 0; j < page->shelf_count; j++) {
+            YagiShelf* shelf = &page->shelves[j];
+            if (shelf->height >= h && shelf->height <= h + h / 2 + 2 && shelf->x + w <= YAGI_GLYPH_PAGE_SIZE) {
+                *x = shelf->x;
+                *y = shelf->y;
+                shelf->x += w;
+                return i;
+            }
+        }
+
+        if (page->shelf_count < YAGI_GLYPH_PAGE_MAX_SHELVES && page->shelf_bottom + h <= YAGI_GLYPH_PAGE_SIZE) {
+            YagiShelf* shelf = &page->shelves[page->shelf_count++];
+            *shelf = (YagiShelf) { .y = page->shelf_bottom, .height = h, .x = w };
+            page->shelf_bottom += h;
+            *x = 0;
+            *y = shelf->y;
+            return i;
+        }
+    }
+
+    if (w > YAGI_GLYPH_PAGE_SIZE || h > YAGI_GLYPH_PAGE_SIZE) return -1;
+
+    YagiGlyphPage* page = NULL;
+    if (font->page_count < YAGI_GLYPH_PAGE_MAX_COUNT) {
+        page = &font->pages[font->page_count++];
+        page->pixels = yagi__calloc(YAGI_GLYPH_PAGE_SIZE * YAGI_GLYPH_PAGE_SIZE, 2);
+        assert(page->pixels != NULL);
+    } else {
+        // Glyphs of pages used this frame may still be waiting to be drawn
+        for (size_t i = 0; i < font->page_count; i++) {
+            YagiGlyphPage* candidate = &font->pages[i];
+            if (candidate->last_used == font->frame) continue;
+            if (page == NULL || candidate->last_used < page->last_used) page = candidate;
+        }
+        if (page == NULL) return -1;
+
+        memset(page->pixels, 0, YAGI_GLYPH_PAGE_SIZE * YAGI_GLYPH_PAGE_SIZE * 2);
+        page->generation++;
+    }
+
+    page->pixel_size = pixel_size;
+    page->shelf_count = 1;
+    page->shelves[0] = (YagiShelf) { .y = 0, .height = h, .x = w };
+    page->shelf_bottom = h;
+    page->dirty_y0 = 0;
+    page->dirty_y1 = YAGI_GLYPH_PAGE_SIZE;
+    *x = 0;
+    *y = 0;
+    return page - font->pages;
+}
+
+static void yagi__font_rasterize(YagiFont* font, int pixel_size, YagiGlyph* glyph) {
+    int codepoint = glyph->codepoint;
+    GlyphInfo* info = LoadFontData(font->file_data, font->file_size, pixel_size, &codepoint, 1, FONT_DEFAULT);
+    if (info == NULL) {
+        glyph->page = -1;
+        glyph->advance_x = pixel_size / 2;
+        return;
+    }
+
+    glyph->offset_x = info->offsetX;
+    glyph->offset_y = info->offsetY;
+    glyph->advance_x = info->advanceX;
+    glyph->page = -1;
+    glyph->rec = (Rectangle) { 0 };
+
+    Image image = info->image;
+    if (image.data != NULL && image.width > 0 && image.height > 0) {
+        const int padding = 1;
+        int x = 0, y = 0;
+        int page_index = yagi__font_pack(font, pixel_size, image.width + padding * 2, image.height + padding * 2, &x, &y);
+        if (page_index >= 0) {
+            YagiGlyphPage* page = &font->pages[page_index];
+            const unsigned char* src = image.data;
+            for (int row = 0; row < image.height; row++) {
+                unsigned char* dst = page->pixels + ((size_t)(y + padding + row) * YAGI_GLYPH_PAGE_SIZE + x + padding) * 2;
+                for (int col = 0; col < image.width; col++) {
+                    dst[col * 2 + 0] = 255;
+                    dst[col * 2 + 1] = src[row * image.width + col];
+                }
+            }
+
+            if (page->dirty_y0 >= page->dirty_y1) {
+                page->dirty_y0 = y;
+                page->dirty_y1 = y + image.height + padding * 2;
+            } else {
+                if (page->dirty_y0 > y) page->dirty_y0 = y;
+                if (page->dirty_y1 < y + image.height + padding * 2) page->dirty_y1 = y + image.height + padding * 2;
+            }
+
+            glyph->page = page_index;
+            glyph->page_generation = page->generation;
+            glyph->rec = (Rectangle) { x + padding, y + padding, image.width, image.height };
+        } else {
+            // Retried when the glyph is used again, some page may be evictable by then
+            glyph->rec.width = -1;
+        }
+    }
+
+    if (glyph->advance_x == 0) glyph->advance_x = image.width;
+    UnloadFontData(info, 1);
+}
+
+static YagiGlyph* yagi__font_glyph(YagiFont* font, YagiFontSize* size, int codepoint) {
+    if ((size->glyph_count + 1) * 4 >= size->glyph_capacity * 3) yagi__font_size_grow(size);
+
+    YagiGlyph* glyph = yagi__font_size_slot(size, codepoint);
+    if (glyph->codepoint == -1) {
+        glyph->codepoint = codepoint;
+        size->glyph_count++;
+        yagi__font_rasterize(font, size->pixel_size, glyph);
+    } else if (glyph->page >= 0 ? glyph->page_generation != font->pages[glyph->page].generation : glyph->rec.width < 0) {
+        // The page of the glyph was evicted or the atlas was full
+        yagi__font_rasterize(font, size->pixel_size, glyph);
+    }
+
+    if (glyph->page >= 0) font->pages[glyph->page].last_used = font->frame;
+    return glyph;
+}
+
+// Frames begun by non-deferred contexts on any thread. Deferred contexts are composited
+// within the frame of the main thread, so their glyphs belong to it as well.
+static atomic_size_t yagi__frame_epoch;
+
+static void yagi__font_lock(YagiFont* font) {
+    while (atomic_flag_test_and_set_explicit(&font->lock, memory_order_acquire)) {}
+
+    size_t epoch = atomic_load_explicit(&yagi__frame_epoch, memory_order_relaxed);
+    if (font->frame_epoch != epoch) {
+        font->frame_epoch = epoch;
+        font->frame++;
+    }
+}
+
+static void yagi__font_unlock(YagiFont* font) {
+    atomic_flag_clear_explicit(&font->lock, memory_order_release);
+}
+
+static Vector2 yagi__font_measure_text(YagiFont* font, const char* text, float font_size, float font_spacing) {
+    yagi__font_lock(font);
+    YagiFontSize* size = yagi__font_size(font, (int)(font_size + 0.5f));
+    float line_width = 0, width = 0, height = font_size;
+    int glyphs = 0;
+
+    while (*text != 0) {
+        int codepoint_size = 0;
+        int codepoint = GetCodepointNext(text, &codepoint_size);
+        text += codepoint_size;
+
+        if (codepoint == '\n') {
+            if (width < line_width) width = line_width;
+            line_width = 0;
+            glyphs = 0;
+            height += font_size + 2;
+            continue;
+        }
+
+        if (glyphs > 0) line_width += font_spacing;
+        line_width += yagi__font_glyph(font, size, codepoint)->advance_x;
+        glyphs++;
+    }
+
+    if (width < line_width) width = line_width;
+    yagi__font_unlock(font);
+    return (Vector2) { width, height };
+}
+
+// Draws the queued glyph quads, one batch per texture
+static void yagi__flush_quads() {
+    for (size_t i = 0; i < yagi_ui.quad_stream_count; i++) {
+        YagiQuadStream* stream = &yagi_ui.quad_streams[i];
+        if (stream->count > 0) {
+            yagi__backend()->draw_quads(stream->texture, stream->quads, stream->count);
+            YAGI__STAT_ADD(draw_calls, 1);
+        }
+        stream->count = 0;
+    }
+    yagi_ui.quad_stream_count = 0;
+}
+
+// Queues a glyph quad into the stream of its texture, or draws it right away if the backend can not batch
+static void yagi__push_quad(Texture2D texture, Rectangle source, Rectangle dest, Color color) {
+    if (yagi__backend()->draw_quads == NULL) {
+        yagi__backend()->draw_texture(texture, source, dest, color);
+        YAGI__STAT_ADD(draw_calls, 1);
+        return;
+    }
+
+    YagiQuadStream* stream = NULL;
+    for (size_t i = yagi_ui.quad_stream_count; i > 0; i--) {
+        if (yagi_ui.quad_streams[i - 1].texture.id == texture.id) {
+            stream = &yagi_ui.quad_streams[i - 1];
+            break;
+        }
+    }
+    if (stream == NULL) {
+        if (yagi_ui.quad_stream_count >= YAGI_QUAD_STREAM_MAX_COUNT) yagi__flush_quads();
+        stream = &yagi_ui.quad_streams[yagi_ui.quad_stream_count++];
+        stream->texture = texture;
+    }
+
+    if (stream->count >= stream->capacity) {
+        if (stream->capacity == 0) stream->capacity = 256;
+        while (stream->count >= stream->capacity) stream->capacity *= 2;
+        stream->quads = YAGI_REALLOC(stream->quads, sizeof(*stream->quads) * stream->capacity);
+        assert(stream->quads != NULL);
+    }
+    stream->quads[stream->count++] = (YagiQuad) { source, dest, color };
+}
+
+static YagiGlyphLut* yagi__glyph_lut(Font font) {
+    for (size_t i = 0; i < YAGI_FONT_MAX_COUNT; i++) {
+        YagiGlyphLut* lut = &yagi_ui.glyph_luts[i];
+        if (lut->slots != NULL && lut->glyphs == font.glyphs && lut->glyph_count == font.glyphCount) return lut;
+    }
+
+    YagiGlyphLut* lut = &yagi_ui.glyph_luts[yagi_ui.glyph_lut_next];
+    yagi_ui.glyph_lut_next = (yagi_ui.glyph_lut_next + 1) % YAGI_FONT_MAX_COUNT;
+    YAGI_FREE(lut->slots);
+    *lut = (YagiGlyphLut) { .glyphs = font.glyphs, .glyph_count = font.glyphCount };
+
+    size_t slot_count = 16;
+    while (slot_count < (size_t)font.glyphCount * 2) slot_count *= 2;
+    lut->slot_mask = slot_count - 1;
+    lut->slots = YAGI_MALLOC(sizeof(*lut->slots) * slot_count * 2);
+    assert(lut->slots != NULL);
+    memset(lut->slots, 0xff, sizeof(*lut->slots) * slot_count * 2);
+    for (size_t i = 0; i < YAGI_GLYPH_LUT_DIRECT; i++) lut->direct[i] = -1;
+
+    // The first glyph of a codepoint wins, like in GetGlyphIndex
+    for (int i = 0; i < font.glyphCount; i++) {
+        int codepoint = font.glyphs[i].value;
+        if (codepoint == '?' && lut->fallback == 0) lut->fallback = i;
+        if (codepoint >= 0 && codepoint < YAGI_GLYPH_LUT_DIRECT) {
+            if (lut->direct[codepoint] < 0) lut->direct[codepoint] = i;
+            continue;
+        }
+
+        size_t slot = ((uint32_t)codepoint * 2654435761u) & lut->slot_mask;
+        while (lut->slots[slot * 2] != -1 && lut->slots[slot * 2] != codepoint) slot = (slot + 1) & lut->slot_mask;
+        if (lut->slots[slot * 2] == -1) {
+            lut->slots[slot * 2] = codepoint;
+            lut->slots[slot * 2 + 1] = i;
+        }
+    }
+    for (size_t i = 0; i < YAGI_GLYPH_LUT_DIRECT; i++) {
+        if (lut->direct[i] < 0) lut->direct[i] = lut->fallback;
+    }
+    return lut;
+}
+
+static int yagi__glyph_lut_index(const YagiGlyphLut* lut, int codepoint) {
+    if (codepoint >= 0 && codepoint < YAGI_GLYPH_LUT_DIRECT) return lut->direct[codepoint];
+
+    size_t slot = ((uint32_t)codepoint * 2654435761u) & lut->slot_mask;
+    while (lut->slots[slot * 2] != -1) {
+        if (lut->slots[slot * 2] == codepoint) return lut->slots[slot * 2 + 1];
+        slot = (slot + 1) & lut->slot_mask;
+    }
+    return lut->fallback;
+}
+
+static int yagi__glyph_index(Font font, int codepoint) {
+    return yagi__glyph_lut_index(yagi__glyph_lut(font), codepoint);
+}
+
+// Queues the quad of one glyph of a raylib Font, placed like DrawTextCodepoint does, and advances pos
+static void yagi__raylib_glyph_quad(Font font, const YagiGlyphLut* lut, int codepoint, Vector2* pos, float font_size, float font_spacing, Color color) {
+    int index = yagi__glyph_lut_index(lut, codepoint);
+    float scale = font_size / font.baseSize;
+    const GlyphInfo* glyph = &font.glyphs[index];
+    Rectangle rec = font.recs[index];
+
+    if (codepoint != ' ' && codepoint != '\t') {
+        float padding = font.glyphPadding;
+        Rectangle source = { rec.x - padding, rec.y - padding, rec.width + padding * 2, rec.height + padding * 2 };
+        Rectangle dest = {
+            pos->x + (glyph->offsetX - padding) * scale,
+            pos->y + (glyph->offsetY - padding) * scale,
+            source.width * scale,
+            source.height * scale,
+        };
+        yagi__push_quad(font.texture, source, dest, color);
+    }
+    pos->x += (glyph->advanceX == 0 ? rec.width : glyph->advanceX) * scale + font_spacing;
+}
+
+static void yagi__raylib_text_quads(Font font, const char* text, Vector2 pos, float font_size, float font_spacing, Color color) {
+    const YagiGlyphLut* lut = yagi__glyph_lut(font);
+    float x = pos.x;
+    while (*text != 0) {
+        int codepoint_size = 0;
+        int codepoint = GetCodepointNext(text, &codepoint_size);
+        text += codepoint_size;
+
+        if (codepoint == '\n') {
+            pos.x = x;
+            pos.y += font_size + 2;
+            continue;
+        }
+        yagi__raylib_glyph_quad(font, lut, codepoint, &pos, font_size, font_spacing, color);
+    }
+}
+
+static void yagi__raylib_codepoint_quads(Font font, const int* codepoints, size_t count, Vector2 pos, float font_size, float font_spacing, Color color) {
+    const YagiGlyphLut* lut = yagi__glyph_lut(font);
+    for (size_t i = 0; i < count; i++) {
+        yagi__raylib_glyph_quad(font, lut, codepoints[i], &pos, font_size, font_spacing, color);
+    }
+}
+
+static void yagi__font_upload(YagiFont* font) {
+    for (size_t i = 0; i < font->page_count; i++) {
+        YagiGlyphPage* page = &font->pages[i];
+        if (page->dirty_y0 >= page->dirty_y1) continue;
+
+        if (page->texture.id == 0) {
+            Image image = {
+                .data = page->pixels,
+                .width = YAGI_GLYPH_PAGE_SIZE,
+                .height = YAGI_GLYPH_PAGE_SIZE,
+                .mipmaps = 1,
+                .format = PIXELFORMAT_UNCOMPRESSED_GRAY_ALPHA,
+            };
+            page->texture = yagi__backend()->load_texture(image);
+        } else {
+            Rectangle rec = { 0, page->dirty_y0, YAGI_GLYPH_PAGE_SIZE, page->dirty_y1 - page->dirty_y0 };
+            yagi__backend()->update_texture(page->texture, rec, page->pixels + (size_t)page->dirty_y0 * YAGI_GLYPH_PAGE_SIZE * 2);
+        }
+        page->dirty_y0 = page->dirty_y1 = 0;
+    }
+}
+
+static void yagi__font_draw_glyph(YagiFont* font, YagiFontSize* size, int codepoint, Vector2* pos, float font_spacing, Color color) {
+    YagiGlyph* glyph = yagi__font_glyph(font, size, codepoint);
+    if (glyph->page >= 0 && codepoint != ' ' && codepoint != '\t') {
+        YagiGlyphPage* page = &font->pages[glyph->page];
+        // Glyphs rasterized just now have to be on the GPU before they are drawn
+        if (page->dirty_y0 < page->dirty_y1) yagi__font_upload(font);
+
+        Rectangle dst = { pos->x + glyph->offset_x, pos->y + glyph->offset_y, glyph->rec.width, glyph->rec.height };
+        yagi__push_quad(page->texture, glyph->rec, dst, color);
+    }
+    pos->x += glyph->advance_x + font_spacing;
+}
+
+static void yagi__font_draw_text(YagiFont* font, const char* text, Vector2 pos, float font_size, float font_spacing, Color color) {
+    yagi__font_lock(font);
+    YagiFontSize* size = yagi__font_size(font, (int)(font_size + 0.5f));
+    float x = pos.x;
+
+    while (*text != 0) {
+        int codepoint_size = 0;
+        int codepoint = GetCodepointNext(text, &codepoint_size);
+        text += codepoint_size;
+
+        if (codepoint == '\n') {
+            pos.x = x;
+            pos.y += font_size + 2;
+            continue;
+        }
+        yagi__font_draw_glyph(font, size, codepoint, &pos, font_spacing, color);
+    }
+    yagi__font_unlock(font);
+}
+
+static void yagi__font_draw_codepoints(YagiFont* font, const int* codepoints, size_t count, Vector2 pos, float font_size, float font_spacing, Color color) {
+    yagi__font_lock(font);
+    YagiFontSize* size = yagi__font_size(font, (int)(font_size + 0.5f));
+    for (size_t i = 0; i < count; i++) {
+        yagi__font_draw_glyph(font, size, codepoints[i], &pos, font_spacing, color);
+    }
+    yagi__font_unlock(font);
+}
+
+static uint8_t yagi__font_index(const YagiStyle* style) {
+    for (size_t i = 0; i < yagi_ui.font_count; i++) {
+        YagiDrawFont* font = &yagi_ui.fonts[i];
+        if (font->dynamic == style->dynamic_font && (font->dynamic != NULL || font->font.texture.id == style->font.texture.id)) return i;
+    }
+
+    if (yagi_ui.font_count >= YAGI_FONT_MAX_COUNT) {
+        fprintf(stderr, "[YAGI] Too many fonts used in one frame (max %d)\n", YAGI_FONT_MAX_COUNT);
+        abort();
+    }
+    yagi_ui.fonts[yagi_ui.font_count] = (YagiDrawFont) { style->font, style->dynamic_font };
+    return yagi_ui.font_count++;
+}
+
+static YagiDrawCmd* yagi__push_cmd(YagiDrawCmdKind kind, Rectangle rect, Color color) {
+    if (yagi_ui.cmd_count >= yagi_ui.cmd_capacity) {
+        if (yagi_ui.cmd_capacity == 0) yagi_ui.cmd_capacity = 256;
+        while (yagi_ui.cmd_count >= yagi_ui.cmd_capacity) yagi_ui.cmd_capacity *= 2;
+        yagi_ui.cmds = YAGI_REALLOC(yagi_ui.cmds, sizeof(*yagi_ui.cmds) * yagi_ui.cmd_capacity);
+        assert(yagi_ui.cmds != NULL);
+    }
+
+    YagiDrawCmd* cmd = &yagi_ui.cmds[yagi_ui.cmd_count];
+    *cmd = (YagiDrawCmd) {
+        .kind = kind,
+        .layer = yagi_ui.layer,
+        .clip = yagi_ui.clip,
+        .seq = yagi_ui.cmd_count,
+        .rect = rect,
+        .color = color,
+    };
+    yagi_ui.cmd_count++;
+    return cmd;
+}
+
+static void yagi__draw_rect(Rectangle rect, Color color) {
+    yagi__push_cmd(YAGI_CMD_RECT, rect, color);
+}
+
+static void yagi__draw_border(Rectangle rect, float thickness, Color color) {
+    yagi__push_cmd(YAGI_CMD_BORDER, rect, color)->size = thickness;
+}
+
+static void yagi__draw_circle(Vector2 center, float radius, Color color) {
+    yagi__push_cmd(YAGI_CMD_CIRCLE, (Rectangle) { center.x, center.y, 0, 0 }, color)->size = radius;
+}
+
+// Draws text that already lives in the frame arena without copying it
+static void yagi__draw_frame_text(const char* text, size_t len, Vector2 pos, Color color) {
+    YagiDrawCmd* cmd = yagi__push_cmd(YAGI_CMD_TEXT, (Rectangle) { pos.x, pos.y, 0, 0 }, color);
+    cmd->font = yagi__font_index(&yagi_ui.style);
+    cmd->size = yagi_ui.style.font_size;
+    cmd->spacing = yagi_ui.style.font_spacing;
+    cmd->data = text;
+    cmd->data_count = len;
+}
+
+static void yagi__draw_text(const char* text, Vector2 pos, Color color) {
+    size_t len = strlen(text);
+    char* copy = yagi_frame_alloc(len + 1);
+    memcpy(copy, text, len + 1);
+    yagi__draw_frame_text(copy, len, pos, color);
+}
+
+static void yagi__draw_codepoints(const int* codepoints, size_t count, Vector2 pos, Color color) {
+    if (count == 0) return;
+    int* copy = yagi_frame_alloc(sizeof(*codepoints) * count);
+    memcpy(copy, codepoints, sizeof(*codepoints) * count);
+
+    YagiDrawCmd* cmd = yagi__push_cmd(YAGI_CMD_CODEPOINTS, (Rectangle) { pos.x, pos.y, 0, 0 }, color);
+    cmd->font = yagi__font_index(&yagi_ui.style);
+    cmd->size = yagi_ui.style.font_size;
+    cmd->spacing = yagi_ui.style.font_spacing;
+    cmd->data = copy;
+    cmd->data_count = count;
+}
+
+static int yagi__draw_key_compare(const void* a, const void* b) {
+    uint64_t ka = ((const YagiDrawKey*)a)->key;
+    uint64_t kb = ((const YagiDrawKey*)b)->key;
+    return (ka > kb) - (ka < kb);
+}
+
+// Sorts the recorded commands by layer, then primitive/texture, then recording order.
+// All shapes share raylib's shapes texture, so within a layer they
+// are drawn together, followed by one run of text per font texture.
+static void yagi__sort_cmds() {
+    if (yagi_ui.cmd_count > yagi_ui.cmd_keys_capacity) {
+        yagi_ui.cmd_keys_capacity = yagi_ui.cmd_capacity;
+        yagi_ui.cmd_keys = YAGI_REALLOC(yagi_ui.cmd_keys, sizeof(*yagi_ui.cmd_keys) * yagi_ui.cmd_keys_capacity);
+        assert(yagi_ui.cmd_keys != NULL);
+    }
+
+    for (size_t i = 0; i < yagi_ui.cmd_count; i++) {
+        YagiDrawCmd* cmd = &yagi_ui.cmds[i];
+        uint64_t group = 0;
+        if (cmd->kind == YAGI_CMD_TEXT || cmd->kind == YAGI_CMD_CODEPOINTS) group = 1 + cmd->font;
+
+        // layer:12 | clip:12 | group:8 | seq:32, field sizes are checked where the limits are defined
+        yagi_ui.cmd_keys[i].key = ((uint64_t)(cmd->layer & 0xfff) << 52) | ((uint64_t)cmd->clip << 40) | (group << 32) | cmd->seq;
+        yagi_ui.cmd_keys[i].index = i;
+    }
+    if (yagi_ui.cmd_count > 1) qsort(yagi_ui.cmd_keys, yagi_ui.cmd_count, sizeof(*yagi_ui.cmd_keys), yagi__draw_key_compare);
+}
+
+static void yagi__replay_cmds() {
+    bool batch_glyphs = yagi__backend()->draw_quads != NULL;
+    uint16_t clip = 0;
+    uint16_t layer = 0;
+    for (size_t i = 0; i < yagi_ui.cmd_count; i++) {
+        YagiDrawCmd* cmd = &yagi_ui.cmds[yagi_ui.cmd_keys[i].index];
+        // Queued glyphs go out before anything that has to be drawn over them
+        bool is_text = cmd->kind == YAGI_CMD_TEXT || cmd->kind == YAGI_CMD_CODEPOINTS;
+        if (yagi_ui.quad_stream_count > 0 && (!is_text || cmd->clip != clip || cmd->layer != layer)) yagi__flush_quads();
+        layer = cmd->layer;
+
+        if (cmd->clip != clip) {
+            if (clip != 0) {
+                yagi__backend()->end_clip();
+                YAGI__STAT_ADD(draw_calls, 1);
+            }
+            clip = cmd->clip;
+            if (clip != 0) {
+                Rectangle r = yagi_ui.clip_rects[clip];
+                yagi__backend()->begin_clip(r);
+                YAGI__STAT_ADD(draw_calls, 1);
+            }
+        }
+
+        switch (cmd->kind) {
+            case YAGI_CMD_RECT:
+                yagi__backend()->draw_rect(cmd->rect, cmd->color);
+                YAGI__STAT_ADD(draw_calls, 1);
+                break;
+            case YAGI_CMD_BORDER:
+                yagi__backend()->draw_border(cmd->rect, cmd->size, cmd->color);
+                YAGI__STAT_ADD(draw_calls, 1);
+                break;
+            case YAGI_CMD_CIRCLE:
+                yagi__backend()->draw_circle((Vector2) { cmd->rect.x, cmd->rect.y }, cmd->size, cmd->color);
+                YAGI__STAT_ADD(draw_calls, 1);
+                break;
+            case YAGI_CMD_TEXT: {
+                YagiDrawFont* font = &yagi_ui.fonts[cmd->font];
+                const char* text = cmd->data;
+                if (font->dynamic != NULL) yagi__font_draw_text(font->dynamic, text, (Vector2) { cmd->rect.x, cmd->rect.y }, cmd->size, cmd->spacing, cmd->color);
+                else if (batch_glyphs) yagi__raylib_text_quads(font->font, text, (Vector2) { cmd->rect.x, cmd->rect.y }, cmd->size, cmd->spacing, cmd->color);
+                else {
+                    yagi__backend()->draw_text(font->font, text, (Vector2) { cmd->rect.x, cmd->rect.y }, cmd->size, cmd->spacing, cmd->color);
+                    YAGI__STAT_ADD(draw_calls, 1);
+                }
+            } break;
+            case YAGI_CMD_CODEPOINTS: {
+                YagiDrawFont* font = &yagi_ui.fonts[cmd->font];
+                const int* codepoints = cmd->data;
+                if (font->dynamic != NULL) yagi__font_draw_codepoints(font->dynamic, codepoints, cmd->data_count, (Vector2) { cmd->rect.x, cmd->rect.y }, cmd->size, cmd->spacing, cmd->color);
+                else if (batch_glyphs) yagi__raylib_codepoint_quads(font->font, codepoints, cmd->data_count, (Vector2) { cmd->rect.x, cmd->rect.y }, cmd->size, cmd->spacing, cmd->color);
+                else {
+                    yagi__backend()->draw_codepoints(font->font, codepoints, cmd->data_count, (Vector2) { cmd->rect.x, cmd->rect.y }, cmd->size, cmd->spacing, cmd->color);
+                    YAGI__STAT_ADD(draw_calls, 1);
+                }
+            } break;
+            default:
+                assert(0);
+        }
+    }
+    if (yagi_ui.quad_stream_count > 0) yagi__flush_quads();
+    if (clip != 0) {
+        yagi__backend()->end_clip();
+        YAGI__STAT_ADD(draw_calls, 1);
+    }
+}
+
+static uint64_t yagi__hash_bytes(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Hash of everything the recorded commands would put on screen
+static uint64_t yagi__hash_cmds() {
+    uint64_t hash = 14695981039346656037ULL;
+    Vector2 screen = yagi_ui.input.screen_size;
+    hash = yagi__hash_bytes(hash, &screen, sizeof(screen));
+
+    for (size_t i = 0; i < yagi_ui.cmd_count; i++) {
+        YagiDrawCmd* cmd = &yagi_ui.cmds[i];
+        // Fields one by one, the padding of the struct is not initialized
+        hash = yagi__hash_bytes(hash, &cmd->kind, sizeof(cmd->kind));
+        hash = yagi__hash_bytes(hash, &cmd->layer, sizeof(cmd->layer));
+        hash = yagi__hash_bytes(hash, &cmd->rect, sizeof(cmd->rect));
+        hash = yagi__hash_bytes(hash, &cmd->size, sizeof(cmd->size));
+        hash = yagi__hash_bytes(hash, &cmd->spacing, sizeof(cmd->spacing));
+        hash = yagi__hash_bytes(hash, &cmd->color, sizeof(cmd->color));
+        if (cmd->clip != 0) hash = yagi__hash_bytes(hash, &yagi_ui.clip_rects[cmd->clip], sizeof(Rectangle));
+
+        if (cmd->kind == YAGI_CMD_TEXT || cmd->kind == YAGI_CMD_CODEPOINTS) {
+            YagiDrawFont* font = &yagi_ui.fonts[cmd->font];
+            unsigned int font_id = font->dynamic != NULL ? font->dynamic->id : font->font.texture.id;
+            hash = yagi__hash_bytes(hash, &font_id, sizeof(font_id));
+            size_t size = cmd->kind == YAGI_CMD_TEXT ? cmd->data_count : cmd->data_count * sizeof(int);
+            hash = yagi__hash_bytes(hash, cmd->data, size);
+        }
+    }
+    return hash;
+}
+
+static bool yagi__backend_can_cache(const YagiBackend* backend) {
+    return backend->load_cache != NULL && backend->unload_cache != NULL && backend->begin_cache != NULL &&
+        backend->end_cache != NULL && backend->present_cache != NULL;
+}
+
+static void yagi__unload_frame_cache() {
+    if (yagi_ui.frame_cache.id != 0) yagi__backend()->unload_cache(yagi_ui.frame_cache);
+    yagi_ui.frame_cache = (RenderTexture2D) {0};
+    yagi_ui.frame_cached = false;
+}
+
+static void yagi__flush_cmds() {
+    const YagiBackend* backend = yagi__backend();
+    if (!yagi_ui.idle_mode || !yagi__backend_can_cache(backend)) {
+        if (!yagi_ui.cmds_sorted) yagi__sort_cmds();
+        yagi__replay_cmds();
+    } else {
+        Vector2 size = backend->screen_size();
+        if (yagi_ui.frame_cache.id == 0 || yagi_ui.frame_cache.texture.width != (int)size.x || yagi_ui.frame_cache.texture.height != (int)size.y) {
+            yagi__unload_frame_cache();
+            yagi_ui.frame_cache = backend->load_cache(size);
+        }
+
+        uint64_t hash = yagi__hash_cmds();
+        if (!yagi_ui.frame_cached || hash != yagi_ui.frame_hash) {
+            if (!yagi_ui.cmds_sorted) yagi__sort_cmds();
+            backend->begin_cache(yagi_ui.frame_cache);
+            yagi__replay_cmds();
+            backend->end_cache();
+            yagi_ui.frame_hash = hash;
+            yagi_ui.frame_cached = true;
+        }
+        backend->present_cache(yagi_ui.frame_cache);
+        YAGI__STAT_ADD(draw_calls, 1);
+    }
+
+    yagi_ui.cmd_count = 0;
+    yagi_ui.font_count = 0;
+    yagi_ui.cmds_sorted = false;
+}
+
+static_assert((YAGI_MEASURE_CACHE_SIZE & (YAGI_MEASURE_CACHE_SIZE - 1)) == 0, "YAGI_MEASURE_CACHE_SIZE must be a power of two");
+
+static Vector2 yagi__measure_style(const YagiStyle* style, const char* text) {
+    YAGI__STAT_ADD(text_measures, 1);
+    unsigned int font_id = style->dynamic_font != NULL ? style->dynamic_font->id : style->font.texture.id;
+    int font_size = style->font_size;
+    int font_spacing = style->font_spacing;
+
+    // FNV-1a over the text, mixed with the rest of the key
+    uint64_t hash = 14695981039346656037ULL;
+    size_t len = 0;
+    for (; text[len] != 0; len++) {
+        hash ^= (unsigned char)text[len];
+        hash *= 1099511628211ULL;
+    }
+    hash ^= len + ((uint64_t)font_id << 32);
+    hash *= 1099511628211ULL;
+    hash ^= ((uint64_t)(uint32_t)font_size << 32) | (uint32_t)font_spacing;
+    hash *= 1099511628211ULL;
+    if (hash == 0) hash = 1;
+
+    size_t mask = YAGI_MEASURE_CACHE_SIZE - 1;
+    YagiMeasureEntry* slot = NULL;
+    for (size_t i = 0; i < YAGI_MEASURE_CACHE_PROBE; i++) {
+        YagiMeasureEntry* entry = &yagi_ui.measure_cache[(hash + i) & mask];
+        if (entry->hash == 0) {
+            if (slot == NULL) slot = entry;
+            break;
+        }
+
+        if (entry->hash == hash && entry->font_id == font_id && entry->font_size == font_size && entry->font_spacing == font_spacing) {
+            entry->last_used = yagi_ui.frame_index;
+            yagi_ui.measure_hits++;
+            return entry->size;
+        }
+
+        if (slot == NULL && yagi_ui.frame_index - entry->last_used > YAGI_MEASURE_CACHE_MAX_AGE) slot = entry;
+    }
+
+    yagi_ui.measure_misses++;
+    YAGI__STAT_ADD(measure_misses, 1);
+    Vector2 size;
+    if (style->dynamic_font != NULL) size = yagi__font_measure_text(style->dynamic_font, text, font_size, font_spacing);
+    else size = yagi__backend()->measure_text(style->font, text, font_size, font_spacing);
+    // Every entry of the probe window is still in use, don't evict any of them
+    if (slot == NULL) return size;
+
+    *slot = (YagiMeasureEntry) {
+        .hash = hash,
+        .font_id = font_id,
+        .font_size = font_size,
+        .font_spacing = font_spacing,
+        .last_used = yagi_ui.frame_index,
+        .size = size,
+    };
+    return size;
+}
+
+Vector2 yagi_measure_text_ex(Font font, const char* text, int font_size, int font_spacing) {
+    YagiStyle style = { .font = font, .font_size = font_size, .font_spacing = font_spacing };
+    return yagi__measure_style(&style, text);
+}
+
+Vector2 yagi_measure_text(const char* text) {
+    return yagi__measure_style(&yagi_ui.style, text);
+}
+
+YagiStyle* yagi_ui_get_style() {
+    return &yagi_ui.style;
+}
+
+YagiStyle yagi_ui_get_style_copy() {
+    return yagi_ui.style;
+}
+
+void yagi_ui_set_default_style() {
+    yagi_ui.style = (YagiStyle) {
+        .bg_color = WHITE,
+        .text_color = BLACK,
+        .font_size = 20,
+        .font_spacing = 1,
+        .font = GetFontDefault()
+    };
+}
+
+static Rectangle yagi__rect_intersect(Rectangle a, Rectangle b) {
+    float x0 = a.x > b.x ? a.x : b.x;
+    float y0 = a.y > b.y ? a.y : b.y;
+    float x1 = a.x + a.width < b.x + b.width ? a.x + a.width : b.x + b.width;
+    float y1 = a.y + a.height < b.y + b.height ? a.y + a.height : b.y + b.height;
+    return (Rectangle) { x0, y0, x1 > x0 ? x1 - x0 : 0, y1 > y0 ? y1 - y0 : 0 };
+}
+
+static uint16_t yagi__push_clip(Rectangle rect) {
+    if (yagi_ui.clip != 0) rect = yagi__rect_intersect(rect, yagi_ui.clip_rects[yagi_ui.clip]);
+
+    if (yagi_ui.clip_rect_count >= YAGI_CLIP_MAX_COUNT) {
+        fprintf(stderr, "[YAGI] Too many clip rectangles in one frame (max %d)\n", YAGI_CLIP_MAX_COUNT);
+        abort();
+    }
+
+    uint16_t parent_clip = yagi_ui.clip;
+    yagi_ui.clip_rects[yagi_ui.clip_rect_count] = rect;
+    yagi_ui.clip = yagi_ui.clip_rect_count++;
+    return parent_clip;
+}
+
+// Returns true if a widget at pos can not be visible with the current clip rectangle.
+// A zero component of size means it is not known yet, so only the other edges are checked.
+static bool yagi__is_clipped(Vector2 pos, Vector2 size) {
+    if (yagi_ui.clip == 0) return false;
+
+    Rectangle clip = yagi_ui.clip_rects[yagi_ui.clip];
+    if (pos.x >= clip.x + clip.width || pos.y >= clip.y + clip.height) return true;
+    if (size.x > 0 && pos.x + size.x <= clip.x) return true;
+    if (size.y > 0 && pos.y + size.y <= clip.y) return true;
+    return false;
+}
+
+// Records rect as the hit area of id on the current layer and returns whether id is the
+// topmost widget under the mouse. Widgets declared later win over earlier ones on the same layer.
+static bool yagi__hit(UIID id, Rectangle rect) {
+    if (yagi_ui.clip != 0) rect = yagi__rect_intersect(rect, yagi_ui.clip_rects[yagi_ui.clip]);
+
+    if (rect.width > 0 && rect.height > 0) {
+        if (yagi_ui.hit_count >= yagi_ui.hit_capacity) {
+            if (yagi_ui.hit_capacity == 0) yagi_ui.hit_capacity = 256;
+            while (yagi_ui.hit_count >= yagi_ui.hit_capacity) yagi_ui.hit_capacity *= 2;
+            yagi_ui.hits = YAGI_REALLOC(yagi_ui.hits, sizeof(*yagi_ui.hits) * yagi_ui.hit_capacity);
+            assert(yagi_ui.hits != NULL);
+        }
+        yagi_ui.hits[yagi_ui.hit_count++] = (YagiHitRect) { rect, id, yagi_ui.layer };
+    }
+
+    return yagi_ui.hot == id;
+}
+
+// Range of grid cells covered by rect, clamped to the grid. Returns false if there are none.
+static bool yagi__hit_cells(Rectangle rect, int* c0, int* r0, int* c1, int* r1) {
+    if (rect.x + rect.width <= 0 || rect.y + rect.height <= 0) return false;
+    *c0 = rect.x > 0 ? (int)(rect.x / YAGI_HIT_CELL_SIZE) : 0;
+    *r0 = rect.y > 0 ? (int)(rect.y / YAGI_HIT_CELL_SIZE) : 0;
+    if (*c0 >= yagi_ui.grid_cols || *r0 >= yagi_ui.grid_rows) return false;
+    *c1 = (int)((rect.x + rect.width) / YAGI_HIT_CELL_SIZE);
+    *r1 = (int)((rect.y + rect.height) / YAGI_HIT_CELL_SIZE);
+    if (*c1 >= yagi_ui.grid_cols) *c1 = yagi_ui.grid_cols - 1;
+    if (*r1 >= yagi_ui.grid_rows) *r1 = yagi_ui.grid_rows - 1;
+    return true;
+}
+
+// Keeps the hit areas of the frame that just ended and buckets them into the grid
+static void yagi__hit_grid_build(void) {
+    YagiHitRect* hits = yagi_ui.prev_hits;
+    size_t hit_capacity = yagi_ui.prev_hit_capacity;
+    yagi_ui.prev_hits = yagi_ui.hits;
+    yagi_ui.prev_hit_count = yagi_ui.hit_count;
+    yagi_ui.prev_hit_capacity = yagi_ui.hit_capacity;
+    yagi_ui.hits = hits;
+    yagi_ui.hit_count = 0;
+    yagi_ui.hit_capacity = hit_capacity;
+
+    Vector2 screen = yagi_ui.input.screen_size;
+    yagi_ui.grid_cols = screen.x > 0 ? (int)(screen.x / YAGI_HIT_CELL_SIZE) + 1 : 0;
+    yagi_ui.grid_rows = screen.y > 0 ? (int)(screen.y / YAGI_HIT_CELL_SIZE) + 1 : 0;
+    size_t cell_count = (size_t)yagi_ui.grid_cols * yagi_ui.grid_rows;
+    if (cell_count + 1 > yagi_ui.grid_cells_capacity) {
+        yagi_ui.grid_cells_capacity = cell_count + 1;
+        yagi_ui.grid_cells = YAGI_REALLOC(yagi_ui.grid_cells, sizeof(*yagi_ui.grid_cells) * yagi_ui.grid_cells_capacity);
+        assert(yagi_ui.grid_cells != NULL);
+    }
+    memset(yagi_ui.grid_cells, 0, sizeof(*yagi_ui.grid_cells) * (cell_count + 1));
+
+    // Count the areas of each cell, then turn the counts into start offsets
+    int c0, r0, c1, r1;
+    for (size_t i = 0; i < yagi_ui.prev_hit_count; i++) {
+        if (!yagi__hit_cells(yagi_ui.prev_hits[i].rect, &c0, &r0, &c1, &r1)) continue;
+        for (int r = r0; r <= r1; r++) {
+            for (int c = c0; c <= c1; c++) yagi_ui.grid_cells[r * yagi_ui.grid_cols + c]++;
+        }
+    }
+    uint32_t total = 0;
+    for (size_t i = 0; i < cell_count; i++) {
+        uint32_t count = yagi_ui.grid_cells[i];
+        yagi_ui.grid_cells[i] = total;
+        total += count;
+    }
+    yagi_ui.grid_cells[cell_count] = total;
 
-YagiUi yagi_ui = {0};
+    if (total > yagi_ui.grid_items_capacity) {
+        if (yagi_ui.grid_items_capacity == 0) yagi_ui.grid_items_capacity = 256;
+        while (total > yagi_ui.grid_items_capacity) yagi_ui.grid_items_capacity *= 2;
+        yagi_ui.grid_items = YAGI_REALLOC(yagi_ui.grid_items, sizeof(*yagi_ui.grid_items) * yagi_ui.grid_items_capacity);
+        assert(yagi_ui.grid_items != NULL);
+    }
 
-YagiStyle* yagi_ui_get_style() {
-    return &yagi_ui.style;
+    // Filling advances each start offset to the start of the next cell, so shift them back after
+    for (size_t i = 0; i < yagi_ui.prev_hit_count; i++) {
+        if (!yagi__hit_cells(yagi_ui.prev_hits[i].rect, &c0, &r0, &c1, &r1)) continue;
+        for (int r = r0; r <= r1; r++) {
+            for (int c = c0; c <= c1; c++) yagi_ui.grid_items[yagi_ui.grid_cells[r * yagi_ui.grid_cols + c]++] = i;
+        }
+    }
+    for (size_t i = cell_count; i > 0; i--) yagi_ui.grid_cells[i] = yagi_ui.grid_cells[i - 1];
+    yagi_ui.grid_cells[0] = 0;
 }
 
-YagiStyle yagi_ui_get_style_copy() {
-    return yagi_ui.style;
-}
+// Topmost hit area of the previous frame containing point: highest layer, then latest declared
+static UIID yagi__hit_pick(Vector2 point) {
+    if (point.x < 0 || point.y < 0) return 0;
+    int c = (int)(point.x / YAGI_HIT_CELL_SIZE);
+    int r = (int)(point.y / YAGI_HIT_CELL_SIZE);
+    if (c >= yagi_ui.grid_cols || r >= yagi_ui.grid_rows) return 0;
 
-void yagi_ui_set_default_style() {
-    yagi_ui.style = (YagiStyle) {
-        .bg_color = WHITE,
-        .text_color = BLACK,
-        .font_size = 20,
-        .font_spacing = 1,
-        .font = GetFontDefault()
-    };
+    size_t cell = (size_t)r * yagi_ui.grid_cols + c;
+    const YagiHitRect* best = NULL;
+    // Items of a cell are in declaration order
+    for (uint32_t i = yagi_ui.grid_cells[cell]; i < yagi_ui.grid_cells[cell + 1]; i++) {
+        const YagiHitRect* hit = &yagi_ui.prev_hits[yagi_ui.grid_items[i]];
+        if (!CheckCollisionPointRec(point, hit->rect)) continue;
+        if (best == NULL || hit->layer >= best->layer) best = hit;
+    }
+    return best != NULL ? best->id : 0;
 }
 
 static Layout* yagi__top_layout_with_loc(const char* file, int line) {
@@ -164,6 +2824,24 @@ static Vector2 yagi_next_widget_pos_with_loc(const char* file, int line) {
 
 static void yagi_expand_layout_with_loc(Vector2 widget_size, const char* file, int line) {
     Layout* top = yagi__top_layout_with_loc(file, line);
+
+    if (top->id != 0) {
+        float main = top->type == LAYOUT_HORZ ? widget_size.x : widget_size.y;
+        float cross = top->type == LAYOUT_HORZ ? widget_size.y : widget_size.x;
+        if (top->placed) main = top->placed_main;
+        else top->has_next = false;
+        top->natural_main += main + top->padding;
+        if (top->cross_size < cross) top->cross_size = cross;
+        top->placed = false;
+    }
+
+    if (top->row_height > 0) {
+        top->size.y += top->row_height;
+        if (top->size.x < widget_size.x) {
+            top->size.x = widget_size.x;
+        }
+        return;
+    }
     
     switch (top->type) {
         case LAYOUT_HORZ:
@@ -181,8 +2859,186 @@ static void yagi_expand_layout_with_loc(Vector2 widget_size, const char* file, i
     }
 }
 
-UIID yagi_id_next() {
-    return ++yagi_ui.id_counter;
+// Skips a widget of the given (partially known) size if it is clipped away, so that
+// it only advances the layout without measuring or drawing anything.
+static bool yagi__cull_with_loc(Vector2 size, const char* file, int line) {
+    if (!yagi__is_clipped(yagi_next_widget_pos_with_loc(file, line), size)) return false;
+
+    yagi_expand_layout_with_loc(size, file, line);
+    yagi_ui.cull_count++;
+    return true;
+}
+
+static uint64_t yagi__hash_mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+static UIID yagi__id_combine(UIID seed, uint64_t value) {
+    UIID id = yagi__hash_mix(seed ^ yagi__hash_mix(value + 0x9e3779b97f4a7c15ULL));
+    // 0 and UINT64_MAX are reserved for "nothing" and "something outside of yagi"
+    if (id == 0 || id == UINT64_MAX) id = 1;
+    return id;
+}
+
+static uint64_t yagi__hash_str(const char* str) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (; *str != 0; str++) {
+        hash ^= (unsigned char)*str;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static UIID yagi__id_seed() {
+    return yagi_ui.id_stack_count > 0 ? yagi_ui.id_stack[yagi_ui.id_stack_count - 1] : 0;
+}
+
+static YagiStateEntry* yagi__state_slot(YagiStateEntry* states, size_t capacity, UIID id) {
+    size_t mask = capacity - 1;
+    size_t i = id & mask;
+    while (states[i].id != 0 && states[i].id != id) {
+        i = (i + 1) & mask;
+    }
+    return &states[i];
+}
+
+// Moves the entries seen in the current frame into a table of the given capacity
+static void yagi__state_rebuild(size_t capacity) {
+    YagiStateEntry* states = yagi_ui.states_spare;
+    if (capacity != yagi_ui.state_capacity || states == NULL) {
+        YAGI_FREE(states);
+        states = YAGI_MALLOC(sizeof(*states) * capacity);
+        assert(states != NULL);
+    }
+    memset(states, 0, sizeof(*states) * capacity);
+
+    size_t count = 0;
+    for (size_t i = 0; i < yagi_ui.state_capacity; i++) {
+        YagiStateEntry* entry = &yagi_ui.states[i];
+        if (entry->id == 0) continue;
+        if (entry->last_seen != yagi_ui.frame_index) {
+            if (entry->data != NULL) {
+                entry->data->next_free = yagi_ui.state_free;
+                yagi_ui.state_free = entry->data;
+            }
+            continue;
+        }
+        *yagi__state_slot(states, capacity, entry->id) = *entry;
+        count++;
+    }
+
+    if (capacity == yagi_ui.state_capacity) {
+        yagi_ui.states_spare = yagi_ui.states;
+    } else {
+        YAGI_FREE(yagi_ui.states);
+        yagi_ui.states_spare = NULL;
+    }
+    yagi_ui.states = states;
+    yagi_ui.state_capacity = capacity;
+    yagi_ui.state_count = count;
+}
+
+static YagiStateEntry* yagi__state_entry(UIID id) {
+    if ((yagi_ui.state_count + 1) * 2 > yagi_ui.state_capacity) {
+        // Entries not seen yet this frame are kept until the end of the frame
+        size_t capacity = yagi_ui.state_capacity == 0 ? 256 : yagi_ui.state_capacity * 2;
+        YagiStateEntry* states = yagi__calloc(capacity, sizeof(*states));
+        assert(states != NULL);
+        for (size_t i = 0; i < yagi_ui.state_capacity; i++) {
+            if (yagi_ui.states[i].id != 0) *yagi__state_slot(states, capacity, yagi_ui.states[i].id) = yagi_ui.states[i];
+        }
+        YAGI_FREE(yagi_ui.states);
+        YAGI_FREE(yagi_ui.states_spare);
+        yagi_ui.states = states;
+        yagi_ui.states_spare = NULL;
+        yagi_ui.state_capacity = capacity;
+    }
+
+    YagiStateEntry* entry = yagi__state_slot(yagi_ui.states, yagi_ui.state_capacity, id);
+    if (entry->id == 0) {
+        entry->id = id;
+        entry->last_seen = 0;
+        entry->repeats = 0;
+        entry->data = NULL;
+        yagi_ui.state_count++;
+    }
+    return entry;
+}
+
+static YagiStateData* yagi__state_data_alloc() {
+    if (yagi_ui.state_free == NULL) {
+        YagiStateData* chunk = YAGI_MALLOC(sizeof(*chunk) * YAGI_STATE_CHUNK_SIZE);
+        assert(chunk != NULL);
+        yagi_ui.state_chunks = YAGI_REALLOC(yagi_ui.state_chunks, sizeof(*yagi_ui.state_chunks) * (yagi_ui.state_chunk_count + 1));
+        assert(yagi_ui.state_chunks != NULL);
+        yagi_ui.state_chunks[yagi_ui.state_chunk_count++] = chunk;
+        for (size_t i = 0; i < YAGI_STATE_CHUNK_SIZE; i++) {
+            chunk[i].next_free = i + 1 < YAGI_STATE_CHUNK_SIZE ? &chunk[i + 1] : NULL;
+        }
+        yagi_ui.state_free = chunk;
+    }
+    YagiStateData* data = yagi_ui.state_free;
+    yagi_ui.state_free = data->next_free;
+    memset(data, 0, sizeof(*data));
+    return data;
+}
+
+static void yagi__state_mark_seen(YagiStateEntry* entry) {
+    if (entry->last_seen != yagi_ui.frame_index) {
+        entry->last_seen = yagi_ui.frame_index;
+        yagi_ui.state_seen++;
+    }
+}
+
+UIID yagi_id_with_loc(const char* file, int line) {
+    UIID id = yagi__id_combine(yagi__id_seed() ^ yagi__hash_str(file), line);
+
+    YagiStateEntry* entry = yagi__state_entry(id);
+    if (entry->last_seen != yagi_ui.frame_index) {
+        entry->repeats = 0;
+        yagi__state_mark_seen(entry);
+        return id;
+    }
+
+    // The same location seen again this frame, e.g. in a loop without its own id scope. The
+    // n-th repeat is numbered by the count kept in the first one.
+    id = yagi__id_combine(id, ++entry->repeats);
+    yagi__state_mark_seen(yagi__state_entry(id));
+    return id;
+}
+
+void* yagi_state_get(UIID id, size_t size) {
+    assert(size <= YAGI_STATE_DATA_SIZE);
+    YagiStateEntry* entry = yagi__state_entry(id);
+    yagi__state_mark_seen(entry);
+    if (entry->data == NULL) entry->data = yagi__state_data_alloc();
+    return entry->data->bytes;
+}
+
+void yagi_push_id(uint64_t value) {
+    if (yagi_ui.id_stack_count >= YAGI_ID_STACK_MAX_COUNT) {
+        fprintf(stderr, "[YAGI] Id stack overflow\n");
+        abort();
+    }
+    yagi_ui.id_stack[yagi_ui.id_stack_count] = yagi__id_combine(yagi__id_seed(), value);
+    yagi_ui.id_stack_count++;
+}
+
+void yagi_push_id_str(const char* str) {
+    yagi_push_id(yagi__hash_str(str));
+}
+
+void yagi_pop_id() {
+    if (yagi_ui.id_stack_count == 0) {
+        fprintf(stderr, "[YAGI] Id stack underflow\n");
+        abort();
+    }
+    yagi_ui.id_stack_count--;
 }
 
 void yagi_begin_layout_with_loc(LayoutType type, Vector2 pos, float padding, const char* file, int line) {
@@ -191,8 +3047,9 @@ void yagi_begin_layout_with_loc(LayoutType type, Vector2 pos, float padding, con
         abort();
     }
 
-    Layout layout = {type, pos, {0, 0}, padding, file, line};
+    Layout layout = { .type = type, .pos = pos, .padding = padding, .file = file, .line = line };
     yagi_ui.layout_stack[yagi_ui.layout_count++] = layout;
+    YAGI__STAT_MAX(peak_layout_count, yagi_ui.layout_count);
 }
 
 void yagi_begin_sublayout_with_loc(LayoutType type, float padding, const char* file, int line) {
@@ -204,8 +3061,93 @@ void yagi_begin_sublayout_with_loc(LayoutType type, float padding, const char* f
     yagi_begin_layout_with_loc(type, yagi_next_widget_pos_with_loc(file, line), padding, file, line);
 }
 
+static void yagi__end_container(Layout* container) {
+    bool horz = container->type == LAYOUT_HORZ;
+    float main_size = horz ? container->fixed_size.x : container->fixed_size.y;
+    float cross_size = horz ? container->fixed_size.y : container->fixed_size.x;
+    if (cross_size <= 0) cross_size = container->cross_size;
+
+    YagiFlexCache solved = { .cross_size = cross_size };
+    float natural = container->natural_main > 0 ? container->natural_main - container->padding : 0;
+    float free = main_size - natural;
+    if (main_size > 0 && free != 0) {
+        // Children that do not flex in this direction keep their size. The others share the
+        // space that is left, and the ones clamped by min or max are frozen at that size before
+        // it is shared again among the rest.
+        bool grow = free > 0;
+        float fixed = natural;
+        for (YagiFlexItem* item = container->flex_items; item != NULL; item = item->next) {
+            item->size = item->natural;
+            item->frozen = (grow ? item->grow : item->shrink) <= 0;
+            if (!item->frozen) fixed -= item->natural;
+        }
+
+        float unit = 0;
+        while (true) {
+            float flexible = 0;
+            float flex_total = 0;
+            for (YagiFlexItem* item = container->flex_items; item != NULL; item = item->next) {
+                if (item->frozen) continue;
+                flexible += item->natural;
+                flex_total += grow ? item->grow : item->shrink;
+            }
+            if (flex_total <= 0) break;
+
+            float left = main_size - fixed - flexible;
+            unit = grow ? left / flex_total : -left / flex_total;
+            float violation = 0;
+            for (YagiFlexItem* item = container->flex_items; item != NULL; item = item->next) {
+                if (item->frozen) continue;
+                float target = grow ? item->natural + item->grow * unit : item->natural - item->shrink * unit;
+                item->size = target;
+                if (item->size < item->min) item->size = item->min;
+                if (item->max > 0 && item->size > item->max) item->size = item->max;
+                violation += item->size - target;
+            }
+            if (violation == 0) break;
+
+            // Only the items clamped in the direction of the total violation are frozen each round
+            for (YagiFlexItem* item = container->flex_items; item != NULL; item = item->next) {
+                if (item->frozen) continue;
+                float target = grow ? item->natural + item->grow * unit : item->natural - item->shrink * unit;
+                if ((violation > 0 && item->size > target) || (violation < 0 && item->size < target)) {
+                    item->frozen = true;
+                    fixed += item->size;
+                }
+            }
+        }
+        if (grow) solved.grow_unit = unit;
+        else solved.shrink_unit = unit;
+
+        // Space that no child took, e.g. when every child reached its max size
+        float used = natural;
+        for (YagiFlexItem* item = container->flex_items; item != NULL; item = item->next) {
+            used += item->size - item->natural;
+        }
+        float left = main_size - used;
+        if (left > 0.5f) {
+            if (container->justify == YAGI_ALIGN_CENTER) solved.main_offset = left / 2;
+            else if (container->justify == YAGI_ALIGN_END) solved.main_offset = left;
+        }
+    }
+
+    YagiFlexCache* cache = yagi_state(container->id, YagiFlexCache);
+    if (memcmp(cache, &solved, sizeof(solved)) != 0) {
+        *cache = solved;
+        yagi_ui.relayout = true;
+    }
+
+    if (container->fixed_size.x > 0) container->size.x = container->fixed_size.x;
+    if (container->fixed_size.y > 0) container->size.y = container->fixed_size.y;
+}
+
 void yagi_end_layout_with_loc(const char* file, int line) {
     Layout* child = yagi__top_layout_with_loc(file, line);
+    if (child->scroll != NULL) {
+        fprintf(stderr, "[YAGI] %s:%d: Scroll region declared at %s:%d must be ended with yagi_end_scroll\n", file, line, child->file, child->line);
+        abort();
+    }
+    if (child->id != 0) yagi__end_container(child);
     yagi_ui.layout_count--;
 
     if (yagi_ui.layout_count > 0) {
@@ -213,21 +3155,237 @@ void yagi_end_layout_with_loc(const char* file, int line) {
     }
 }
 
+void yagi_begin_container_with_loc(LayoutType type, Vector2 size, YagiAlign justify, float padding, const char* file, int line) {
+    if (yagi_ui.layout_count <= 0) {
+        fprintf(stderr, "[YAGI] %s: %d: Layout needed to create container\n", file, line);
+        abort();
+    }
+
+    UIID id = yagi_id_with_loc(file, line);
+    YagiFlexCache solved = *yagi_state(id, YagiFlexCache);
+
+    yagi_begin_sublayout_with_loc(type, padding, file, line);
+    Layout* top = yagi__top_layout_with_loc(file, line);
+    top->id = id;
+    top->fixed_size = size;
+    top->justify = justify;
+    top->solved = solved;
+    if (type == LAYOUT_HORZ) top->size.x = solved.main_offset;
+    else top->size.y = solved.main_offset;
+}
+
+void yagi_flex_with_loc(YagiFlex flex, const char* file, int line) {
+    Layout* top = yagi__top_layout_with_loc(file, line);
+    if (top->id == 0) {
+        fprintf(stderr, "[YAGI] %s: %d: yagi_flex needs to be called inside of a container\n", file, line);
+        abort();
+    }
+    top->next = flex;
+    top->has_next = true;
+}
+
+// Returns where a widget of the given natural size goes and how big it ends up.
+// Outside of containers that is just the natural size at the next widget position.
+static Rectangle yagi__place_with_loc(Vector2 natural, const char* file, int line) {
+    Vector2 pos = yagi_next_widget_pos_with_loc(file, line);
+    Rectangle rect = { pos.x, pos.y, natural.x, natural.y };
+
+    Layout* top = yagi__top_layout_with_loc(file, line);
+    if (top->id == 0) return rect;
+
+    YagiFlex flex = top->has_next ? top->next : (YagiFlex) {0};
+    bool horz = top->type == LAYOUT_HORZ;
+    float min_main = horz ? flex.min_size.x : flex.min_size.y;
+    float max_main = horz ? flex.max_size.x : flex.max_size.y;
+    float natural_main = horz ? natural.x : natural.y;
+    if (natural_main < min_main) natural_main = min_main;
+    if (max_main > 0 && natural_main > max_main) natural_main = max_main;
+    float main = natural_main + flex.grow * top->solved.grow_unit - flex.shrink * natural_main * top->solved.shrink_unit;
+    if (main < min_main) main = min_main;
+    if (max_main > 0 && main > max_main) main = max_main;
+    float cross = horz ? natural.y : natural.x;
+
+    float cross_size = top->solved.cross_size;
+    float cross_offset = 0;
+    switch (flex.align) {
+        case YAGI_ALIGN_START: break;
+        case YAGI_ALIGN_CENTER: cross_offset = (cross_size - cross) / 2; break;
+        case YAGI_ALIGN_END: cross_offset = cross_size - cross; break;
+        case YAGI_ALIGN_STRETCH: if (cross_size > cross) cross = cross_size; break;
+    }
+    if (cross_offset < 0) cross_offset = 0;
+
+    Vector2 size = horz ? (Vector2) { main, cross } : (Vector2) { cross, main };
+    if (size.x < flex.min_size.x) size.x = flex.min_size.x;
+    if (size.y < flex.min_size.y) size.y = flex.min_size.y;
+    if (flex.max_size.x > 0 && size.x > flex.max_size.x) size.x = flex.max_size.x;
+    if (flex.max_size.y > 0 && size.y > flex.max_size.y) size.y = flex.max_size.y;
+
+    if (horz) rect = (Rectangle) { pos.x, pos.y + cross_offset, size.x, size.y };
+    else rect = (Rectangle) { pos.x + cross_offset, pos.y, size.x, size.y };
+
+    if (flex.grow > 0 || flex.shrink > 0) {
+        YagiFlexItem* item = yagi_frame_alloc(sizeof(*item));
+        *item = (YagiFlexItem) {
+            .natural = natural_main,
+            .grow = flex.grow,
+            .shrink = flex.shrink * natural_main,
+            .min = min_main,
+            .max = max_main,
+            .next = top->flex_items,
+        };
+        top->flex_items = item;
+    }
+    top->placed = true;
+    top->placed_main = natural_main;
+    top->has_next = false;
+    return rect;
+}
+
+void yagi_begin_scroll_with_loc(Vector2 size, YagiScroll* scroll, const char* file, int line) {
+    Vector2 pos = yagi_next_widget_pos_with_loc(file, line);
+    Rectangle view = { pos.x, pos.y, size.x, size.y };
+
+    uint16_t parent_clip = yagi__push_clip(view);
+    yagi_begin_layout_with_loc(LAYOUT_VERT, (Vector2) { pos.x - scroll->offset.x, pos.y - scroll->offset.y }, 0, file, line);
+
+    Layout* top = yagi__top_layout_with_loc(file, line);
+    top->scroll = scroll;
+    top->view = view;
+    top->parent_clip = parent_clip;
+    top->cull_start = yagi_ui.cull_count;
+}
+
+void yagi_end_scroll_with_loc(const char* file, int line) {
+    Layout* child = yagi__top_layout_with_loc(file, line);
+    if (child->scroll == NULL) {
+        fprintf(stderr, "[YAGI] %s:%d: yagi_end_scroll called without yagi_begin_scroll\n", file, line);
+        abort();
+    }
+    yagi_ui.layout_count--;
+
+    YagiScroll* scroll = child->scroll;
+    Rectangle view = child->view;
+    // Culled widgets only know their height, so the widest one seen stays the content width
+    if (yagi_ui.cull_count == child->cull_start || child->size.x > scroll->content_size.x) {
+        scroll->content_size.x = child->size.x;
+    }
+    scroll->content_size.y = child->size.y;
+
+    // Inner scroll regions end first, so they get the wheel before the regions around them
+    Vector2 mouse = yagi_ui.input.mouse;
+    if (!yagi_ui.wheel_consumed && CheckCollisionPointRec(mouse, view)) {
+        Vector2 wheel = yagi_ui.input.wheel;
+        if (wheel.x != 0 || wheel.y != 0) {
+            scroll->offset.x -= wheel.x * yagi_ui.style.font_size * 2;
+            scroll->offset.y -= wheel.y * yagi_ui.style.font_size * 2;
+            yagi_ui.wheel_consumed = true;
+        }
+    }
+
+    Vector2 max_offset = { scroll->content_size.x - view.width, scroll->content_size.y - view.height };
+    if (scroll->offset.x > max_offset.x) scroll->offset.x = max_offset.x;
+    if (scroll->offset.y > max_offset.y) scroll->offset.y = max_offset.y;
+    if (scroll->offset.x < 0) scroll->offset.x = 0;
+    if (scroll->offset.y < 0) scroll->offset.y = 0;
+
+    if (max_offset.y > 0) {
+        float thumb_height = view.height * view.height / scroll->content_size.y;
+        if (thumb_height < 10) thumb_height = 10;
+        Rectangle thumb = {
+            view.x + view.width - 6,
+            view.y + (view.height - thumb_height) * scroll->offset.y / max_offset.y,
+            6, thumb_height
+        };
+        yagi__draw_rect(thumb, Fade(yagi_ui.style.text_color, 0.5));
+    }
+    // Restored only now so the thumb shares the clip of the content and sorts after it
+    yagi_ui.clip = child->parent_clip;
+
+    if (yagi_ui.layout_count > 0) {
+        yagi_expand_layout_with_loc((Vector2) { view.width, view.height }, file, line);
+    }
+}
+
+void yagi_begin_rows_with_loc(float row_height, size_t row_count, size_t* first, size_t* last, const char* file, int line) {
+    yagi_begin_sublayout_with_loc(LAYOUT_VERT, 0, file, line);
+    Layout* top = yagi__top_layout_with_loc(file, line);
+    top->row_height = row_height;
+    top->row_count = row_count;
+
+    size_t begin = 0, end = row_count;
+    if (yagi_ui.clip != 0 && row_height > 0) {
+        Rectangle clip = yagi_ui.clip_rects[yagi_ui.clip];
+        float top_y = clip.y - top->pos.y;
+        float bottom_y = clip.y + clip.height - top->pos.y;
+
+        begin = top_y > 0 ? (size_t)(top_y / row_height) : 0;
+        end = bottom_y > 0 ? (size_t)(bottom_y / row_height) + 1 : 0;
+        if (begin > row_count) begin = row_count;
+        if (end > row_count) end = row_count;
+        if (end < begin) end = begin;
+    }
+    if (begin > 0 || end < row_count) yagi_ui.cull_count++;
+
+    top->size.y = begin * row_height;
+    *first = begin;
+    *last = end;
+}
+
+void yagi_end_rows_with_loc(const char* file, int line) {
+    Layout* top = yagi__top_layout_with_loc(file, line);
+    if (top->row_height <= 0) {
+        fprintf(stderr, "[YAGI] %s:%d: yagi_end_rows called without yagi_begin_rows\n", file, line);
+        abort();
+    }
+    top->size.y = top->row_height * top->row_count;
+    yagi_end_layout_with_loc(file, line);
+}
+
 void yagi_ui_begin_with_loc(const char* file, int line) {
     if (yagi_ui.start_counter > 0) {
         fprintf(stderr, "[YAGI] %s:%d: yagi_ui_end was not called\n", file, line);
         abort();
     }
     yagi_ui.start_counter += 1;
+    yagi_ui.frame_index += 1;
+#ifndef YAGI_NO_STATS
+    yagi_ui.stats = (YagiFrameStats) {0};
+    yagi_ui.stats_frame_start = yagi__now_ns();
+#endif // YAGI_NO_STATS
+    if (!yagi_ui.deferred) {
+        atomic_fetch_add_explicit(&yagi__frame_epoch, 1, memory_order_relaxed);
+        if (yagi__backend()->begin_frame != NULL) yagi__backend()->begin_frame();
+    }
+    yagi__arena_reset(&yagi_ui.frame_arena);
 
     yagi_ui.highlight = 0;
-    yagi_ui.id_counter = 0;
+    yagi__input_read(&yagi_ui.input);
+#ifndef YAGI_NO_STATS
+    yagi_ui.stats.frame_time_ms = yagi_ui.input.frame_time * 1000;
+    if (yagi_ui.input_replayed) {
+        // The widgets see the logged frame time, the live one is kept next to it for comparison
+        const YagiBackend* backend = yagi__backend();
+        yagi_ui.stats.logged_frame_time_ms = yagi_ui.stats.frame_time_ms;
+        yagi_ui.stats.frame_time_ms = !yagi_ui.deferred && backend->frame_time != NULL ? backend->frame_time() * 1000 : 0;
+    }
+#endif // YAGI_NO_STATS
+    yagi_ui.had_input = yagi__input_any(&yagi_ui.input);
+    yagi_ui.hot = yagi__hit_pick(yagi_ui.input.mouse);
+    yagi_ui.id_stack_count = 0;
+    yagi_ui.state_seen = 0;
+    yagi_ui.layer = YAGI_LAYER_BASE;
+    yagi_ui.clip = 0;
+    yagi_ui.clip_rect_count = 1;
+    yagi_ui.wheel_consumed = false;
+    yagi_ui.relayout = false;
+    yagi_ui.frame_requested = false;
 
     yagi_ui_set_default_style();
 }
 
 void yagi_ui_end_with_loc(const char* file, int line) {
-    if (!IsMouseButtonDown(MOUSE_BUTTON_LEFT)) yagi_ui.active = 0;
+    if (!yagi__mouse_down(MOUSE_BUTTON_LEFT)) yagi_ui.active = 0;
     else if (yagi_ui.active == 0) yagi_ui.active = UINT64_MAX;
 
     if (yagi_ui.layout_count > 0) {
@@ -239,52 +3397,194 @@ void yagi_ui_end_with_loc(const char* file, int line) {
         abort();
     }
 
+    if (yagi_ui.id_stack_count > 0) {
+        fprintf(stderr, "[YAGI] %s:%d: Id stack not empty (%zu ids pushed)\n", file, line, yagi_ui.id_stack_count);
+        abort();
+    }
+
     if (yagi_ui.start_counter == 0) {
         fprintf(stderr, "[YAGI] %s:%d: yagi_ui_begin was not called\n", file, line);
         abort();
     }
     yagi_ui.start_counter -= 1;
+
+    if (yagi_ui.deferred) {
+        yagi__sort_cmds();
+        yagi_ui.cmds_sorted = true;
+    } else {
+        yagi__flush_cmds();
+    }
+
+    yagi__hit_grid_build();
+    if (yagi_ui.record_file != NULL) yagi__log_write_frame(yagi_ui.record_file, &yagi_ui.input);
+
+    // Drop the state of widgets that were not seen this frame
+    if (yagi_ui.state_seen < yagi_ui.state_count) yagi__state_rebuild(yagi_ui.state_capacity);
+
+#ifndef YAGI_NO_STATS
+    yagi_ui.stats.frame_ns = yagi__now_ns() - yagi_ui.stats_frame_start;
+    yagi_ui.stats_history[yagi_ui.stats_history_next] = yagi_ui.stats;
+    yagi_ui.stats_history_next = (yagi_ui.stats_history_next + 1) % YAGI_STATS_FRAMES;
+    if (yagi_ui.stats_history_count < YAGI_STATS_FRAMES) yagi_ui.stats_history_count++;
+#endif // YAGI_NO_STATS
+
+    if (yagi_ui.idle_mode && !yagi_ui.deferred) {
+        bool wait = !yagi_ui_needs_frame();
+        if (wait != yagi_ui.event_waiting && yagi__backend()->wait_events != NULL) yagi__backend()->wait_events(wait);
+        yagi_ui.event_waiting = wait;
+    }
+
+    if (!yagi_ui.deferred && yagi__backend()->end_frame != NULL) yagi__backend()->end_frame();
+}
+
+bool yagi_ui_needs_frame() {
+    return yagi_ui.active != 0 || yagi_ui.focus != 0 || yagi_ui.relayout || yagi_ui.frame_requested || yagi_ui.had_input || yagi_ui.replay_file != NULL;
+}
+
+void yagi_ui_request_frame() {
+    yagi_ui.frame_requested = true;
+}
+
+#ifndef YAGI_NO_STATS
+static int yagi__float_compare(const void* a, const void* b) {
+    float fa = *(const float*)a;
+    float fb = *(const float*)b;
+    return (fa > fb) - (fa < fb);
+}
+
+static YagiStatRange yagi__stat_range(float* values, size_t count) {
+    if (count == 0) return (YagiStatRange) {0};
+
+    float sum = 0;
+    for (size_t i = 0; i < count; i++) sum += values[i];
+    qsort(values, count, sizeof(*values), yagi__float_compare);
+
+    size_t p99 = count * 99 / 100;
+    if (p99 >= count) p99 = count - 1;
+    return (YagiStatRange) { values[0], sum / count, values[p99] };
+}
+
+// Gathers expr over the history, with frame being each of the frames in turn
+#define YAGI__STAT_RANGE(expr) do { \
+        for (size_t i = 0; i < count; i++) { \
+            const YagiFrameStats* frame = &yagi_ui.stats_history[i]; \
+            values[i] = (expr); \
+        } \
+        range = yagi__stat_range(values, count); \
+    } while (0)
+#endif // YAGI_NO_STATS
+
+YagiStats yagi_ui_stats() {
+    YagiStats stats = {0};
+#ifndef YAGI_NO_STATS
+    size_t count = yagi_ui.stats_history_count;
+    if (count == 0) return stats;
+
+    float values[YAGI_STATS_FRAMES];
+    YagiStatRange range;
+    stats.frames = count;
+    stats.last = yagi_ui.stats_history[(yagi_ui.stats_history_next + YAGI_STATS_FRAMES - 1) % YAGI_STATS_FRAMES];
+
+    YAGI__STAT_RANGE(frame->frame_ns / 1e6f);
+    stats.frame_ms = range;
+    YAGI__STAT_RANGE(frame->frame_time_ms);
+    stats.frame_time_ms = range;
+    YAGI__STAT_RANGE(frame->logged_frame_time_ms);
+    stats.logged_frame_time_ms = range;
+    YAGI__STAT_RANGE(frame->peak_layout_count);
+    stats.peak_layout_count = range;
+    YAGI__STAT_RANGE(frame->text_measures);
+    stats.text_measures = range;
+    YAGI__STAT_RANGE(frame->measure_misses);
+    stats.measure_misses = range;
+    YAGI__STAT_RANGE(frame->draw_calls);
+    stats.draw_calls = range;
+    YAGI__STAT_RANGE(frame->bytes_formatted);
+    stats.bytes_formatted = range;
+
+    for (size_t i = 0; i < count; i++) {
+        const YagiFrameStats* frame = &yagi_ui.stats_history[i];
+        values[i] = 0;
+        for (size_t kind = 0; kind < YAGI_WIDGET_KIND_COUNT; kind++) values[i] += frame->widgets[kind];
+    }
+    stats.widgets = yagi__stat_range(values, count);
+
+    for (size_t kind = 0; kind < YAGI_WIDGET_KIND_COUNT; kind++) {
+        YAGI__STAT_RANGE(frame->widget_ns[kind] / 1e6f);
+        stats.widget_ms[kind] = range;
+    }
+#endif // YAGI_NO_STATS
+    return stats;
+}
+
+void yagi_ui_set_idle_mode(bool enabled) {
+    if (yagi_ui.idle_mode == enabled) return;
+    yagi_ui.idle_mode = enabled;
+
+    if (!enabled) {
+        if (yagi_ui.event_waiting && yagi__backend()->wait_events != NULL) yagi__backend()->wait_events(false);
+        yagi_ui.event_waiting = false;
+        yagi__unload_frame_cache();
+    }
+}
+
+static void yagi__text(const char* file, int line, const char* fmt, va_list args) {
+    if (yagi__cull_with_loc((Vector2) { 0, yagi_ui.style.font_size }, file, line)) return;
+
+    char* text = yagi_frame_vprintf(fmt, args);
+
+    Vector2 text_size = yagi_measure_text(text);
+    Rectangle rect = yagi__place_with_loc(text_size, file, line);
+    yagi__draw_frame_text(text, strlen(text), (Vector2) { rect.x, rect.y }, yagi_ui.style.text_color);
+
+    yagi_expand_layout_with_loc((Vector2) { rect.width, rect.height }, file, line);
+}
+
+static void yagi__vtext_with_loc(const char* file, int line, const char* fmt, va_list args) {
+    YAGI__STAT_WIDGET_BEGIN();
+    yagi__text(file, line, fmt, args);
+    YAGI__STAT_WIDGET_END(YAGI_WIDGET_TEXT);
 }
 
 void yagi_text_with_loc(const char* file, int line, const char* fmt, ...) {
-static char yagi_text_buffer[4096] = {0};
     va_list args;
-
     va_start(args, fmt);
-    vsnprintf(yagi_text_buffer, 4096, fmt, args);
+    yagi__vtext_with_loc(file, line, fmt, args);
     va_end(args);
+}
 
-    Vector2 pos = yagi_next_widget_pos_with_loc(file, line);
-
-    Vector2 text_size = MeasureTextEx(yagi_ui.style.font, yagi_text_buffer, yagi_ui.style.font_size, yagi_ui.style.font_spacing);
-    DrawTextEx(yagi_ui.style.font, yagi_text_buffer, (Vector2) {pos.x, pos.y}, yagi_ui.style.font_size, yagi_ui.style.font_spacing, yagi_ui.style.text_color);
-
-    yagi_expand_layout_with_loc(text_size, file, line);
+static void yagi__empty(Vector2 size, const char* file, int line) {
+    Rectangle rect = yagi__place_with_loc(size, file, line);
+    yagi_expand_layout_with_loc((Vector2) { rect.width, rect.height }, file, line);
 }
 
 void yagi_empty_with_loc(Vector2 size, const char* file, int line) {
-    yagi_expand_layout_with_loc(size, file, line);
+    YAGI__STAT_WIDGET_BEGIN();
+    yagi__empty(size, file, line);
+    YAGI__STAT_WIDGET_END(YAGI_WIDGET_EMPTY);
 }
 
-bool yagi_button_with_loc(const char* label, const char* file, int line) {
-    UIID id = yagi_id_next();
+static bool yagi__button(const char* label, const char* file, int line) {
+    UIID id = yagi_id_with_loc(file, line);
     bool clicked = false;
 
-    Vector2 widget_size = { MeasureText(label, yagi_ui.style.font_size), yagi_ui.style.font_size };
-    Vector2 pos = yagi_next_widget_pos_with_loc(file, line);
-    Rectangle rect = { pos.x, pos.y, widget_size.x, widget_size.y };
-    Rectangle border_rect = { rect.x - 2, rect.y - 2, rect.width + 4, rect.height + 4 };
+    if (yagi_ui.active != id && yagi__cull_with_loc((Vector2) { 0, yagi_ui.style.font_size + 4 }, file, line)) return false;
+
+    Vector2 widget_size = yagi_measure_text(label);
+    Rectangle border_rect = yagi__place_with_loc((Vector2) { widget_size.x + 4, widget_size.y + 4 }, file, line);
+    border_rect.x -= 2;
+    border_rect.y -= 2;
+    Rectangle rect = { border_rect.x + 2, border_rect.y + 2, border_rect.width - 4, border_rect.height - 4 };
 
-    Vector2 mouse = GetMousePosition();
-    bool collides = CheckCollisionPointRec(mouse, rect);
+    bool collides = yagi__hit(id, rect);
     if (collides) {
         yagi_ui.highlight = id;
-        if (yagi_ui.active == 0 && IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
+        if (yagi_ui.active == 0 && yagi__mouse_pressed(MOUSE_BUTTON_LEFT)) {
             yagi_ui.active = id;
         }
     }
 
-    if (yagi_ui.active == id && IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
+    if (yagi_ui.active == id && yagi__mouse_released(MOUSE_BUTTON_LEFT)) {
         if (collides) {
             clicked = true;
         }
@@ -294,79 +3594,273 @@ bool yagi_button_with_loc(const char* label, const char* file, int line) {
     Color bg = yagi_ui.style.bg_color;
     if (yagi_ui.highlight == id) bg = ColorBrightness(bg, -0.5);
 
-    DrawRectangleRec(border_rect, yagi_ui.style.text_color);
-    DrawRectangleRec(rect, bg);
-    DrawTextEx(yagi_ui.style.font, label, (Vector2) {rect.x + rect.width / 2 - widget_size.x / 2, rect.y + rect.height / 2 - widget_size.y / 2}, yagi_ui.style.font_size, yagi_ui.style.font_spacing, yagi_ui.style.text_color);
+    yagi__draw_border(border_rect, 2, yagi_ui.style.text_color);
+    yagi__draw_rect(rect, bg);
+    yagi__draw_text(label, (Vector2) {rect.x + rect.width / 2 - widget_size.x / 2, rect.y + rect.height / 2 - widget_size.y / 2}, yagi_ui.style.text_color);
 
-    widget_size.x = border_rect.width;
-    widget_size.y = border_rect.height;
-    yagi_expand_layout_with_loc(widget_size, file, line);
+    yagi_expand_layout_with_loc((Vector2) { border_rect.width, border_rect.height }, file, line);
 
     return clicked;
 }
 
-bool yagi_dropdown_with_loc(int* already_selected, char* labels[], size_t label_count, const char* file, int line) {
+bool yagi_button_with_loc(const char* label, const char* file, int line) {
+    YAGI__STAT_WIDGET_BEGIN();
+    bool result = yagi__button(label, file, line);
+    YAGI__STAT_WIDGET_END(YAGI_WIDGET_BUTTON);
+    return result;
+}
+
+// Per dropdown state. The widest label is only measured again when the labels or the font change.
+typedef struct {
+    char** labels;
+    uint32_t label_count;
+    uint32_t style_key;
+    float width;
+    float scroll;
+}YagiDropdownState;
+
+static_assert(sizeof(YagiDropdownState) <= YAGI_STATE_DATA_SIZE, "YagiDropdownState does not fit in the state store");
+
+static _Thread_local const char* yagi__suffix_text;
+
+static int yagi__suffix_compare(const void* a, const void* b) {
+    return strcmp(yagi__suffix_text + *(const uint32_t*)a, yagi__suffix_text + *(const uint32_t*)b);
+}
+
+static char yagi__ascii_lower(char c) {
+    return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+// Suffix array over the lowercased labels, each terminated by a 0 so no suffix runs into the next label
+static void yagi__dropdown_filter_build(YagiDropdownFilter* filter, char* labels[], size_t label_count) {
+    yagi_dropdown_filter_free(filter);
+    filter->labels = labels;
+    filter->label_count = label_count;
+
+    size_t text_size = 0;
+    for (size_t i = 0; i < label_count; i++) text_size += strlen(labels[i]) + 1;
+    assert(text_size <= UINT32_MAX);
+
+    filter->text = YAGI_MALLOC(text_size);
+    filter->owners = YAGI_MALLOC(sizeof(*filter->owners) * text_size);
+    filter->suffixes = YAGI_MALLOC(sizeof(*filter->suffixes) * text_size);
+    filter->marks = yagi__calloc(label_count, sizeof(*filter->marks));
+    filter->matches = YAGI_MALLOC(sizeof(*filter->matches) * (label_count > 0 ? label_count : 1));
+    assert(filter->text != NULL && filter->owners != NULL && filter->suffixes != NULL && filter->marks != NULL && filter->matches != NULL);
+
+    size_t pos = 0;
+    for (size_t i = 0; i < label_count; i++) {
+        for (const char* c = labels[i]; *c != 0; c++) {
+            filter->suffixes[filter->suffix_count++] = pos;
+            filter->owners[pos] = i;
+            filter->text[pos++] = yagi__ascii_lower(*c);
+        }
+        filter->owners[pos] = i;
+        filter->text[pos++] = 0;
+    }
+
+    yagi__suffix_text = filter->text;
+    qsort(filter->suffixes, filter->suffix_count, sizeof(*filter->suffixes), yagi__suffix_compare);
+    filter->query_dirty = true;
+}
+
+// Labels containing the query, in their original order
+static void yagi__dropdown_filter_update(YagiDropdownFilter* filter) {
+    filter->query_dirty = false;
+    filter->match_count = 0;
+
+    if (filter->query_len == 0) {
+        for (size_t i = 0; i < filter->label_count; i++) filter->matches[filter->match_count++] = i;
+        return;
+    }
+
+    char query[YAGI_DROPDOWN_QUERY_MAX];
+    for (size_t i = 0; i < filter->query_len; i++) query[i] = yagi__ascii_lower(filter->query[i]);
+
+    // Suffixes starting with the query are one contiguous range of the suffix array
+    size_t lo = 0, hi = filter->suffix_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (strncmp(filter->text + filter->suffixes[mid], query, filter->query_len) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    size_t first = lo;
+    hi = filter->suffix_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (strncmp(filter->text + filter->suffixes[mid], query, filter->query_len) <= 0) lo = mid + 1;
+        else hi = mid;
+    }
+
+    filter->mark++;
+    size_t found = 0;
+    for (size_t i = first; i < lo; i++) {
+        uint32_t owner = filter->owners[filter->suffixes[i]];
+        if (filter->marks[owner] != filter->mark) {
+            filter->marks[owner] = filter->mark;
+            found++;
+        }
+    }
+    for (size_t i = 0; i < filter->label_count && filter->match_count < found; i++) {
+        if (filter->marks[i] == filter->mark) filter->matches[filter->match_count++] = i;
+    }
+}
+
+void yagi_dropdown_filter_free(YagiDropdownFilter* filter) {
+    YAGI_FREE(filter->text);
+    YAGI_FREE(filter->owners);
+    YAGI_FREE(filter->suffixes);
+    YAGI_FREE(filter->marks);
+    YAGI_FREE(filter->matches);
+    *filter = (YagiDropdownFilter) {0};
+}
+
+static bool yagi__dropdown(int* already_selected, char* labels[], size_t label_count, YagiDropdownFilter* filter, const char* file, int line) {
     int selected = *already_selected;
     bool changed = false;
-    UIID id = yagi_id_next();
+    UIID id = yagi_id_with_loc(file, line);
+    YagiDropdownState* state = yagi_state(id, YagiDropdownState);
+
+    unsigned int font_id = yagi_ui.style.dynamic_font != NULL ? yagi_ui.style.dynamic_font->id : yagi_ui.style.font.texture.id;
+    uint32_t style_key = (uint32_t)yagi__id_combine(font_id, ((uint64_t)yagi_ui.style.font_size << 32) | (uint32_t)yagi_ui.style.font_spacing);
+    if (state->labels != labels || state->label_count != label_count || state->style_key != style_key) {
+        state->labels = labels;
+        state->label_count = label_count;
+        state->style_key = style_key;
+        state->width = yagi_measure_text("Select...").x;
+        for (size_t i = 0; i < label_count; i++) {
+            Vector2 text_size = yagi_measure_text(labels[i]);
+            if (state->width < text_size.x) state->width = text_size.x;
+        }
+    }
 
     yagi_begin_sublayout(LAYOUT_VERT, 0);
     Vector2 pos = yagi_next_widget_pos_with_loc(file, line);
-    Rectangle rect = { pos.x, pos.y, 0, yagi_ui.style.font_size };
-    for (size_t i = 0; i < label_count; i++) {
-        Vector2 text_size = MeasureTextEx(yagi_ui.style.font, labels[i], yagi_ui.style.font_size, yagi_ui.style.font_spacing);
-        if (rect.width < text_size.x) rect.width = text_size.x;
-    }
-
-    if (selected < 0) {
-        Vector2 text_size = MeasureTextEx(yagi_ui.style.font, "Select...", yagi_ui.style.font_size, yagi_ui.style.font_spacing);
-        if (rect.width < text_size.x) rect.width = text_size.x;
-    }
+    Rectangle rect = { pos.x, pos.y, state->width, yagi_ui.style.font_size };
 
-    Vector2 mouse = GetMousePosition();
-    bool collides_main = CheckCollisionPointRec(mouse, rect);
+    bool collides_main = yagi__hit(id, rect);
     if (collides_main) {
         yagi_ui.highlight = id;
-        if (yagi_ui.active == 0 && IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
+        if (yagi_ui.active == 0 && yagi__mouse_pressed(MOUSE_BUTTON_LEFT)) {
             yagi_ui.active = id;
         }
     }
 
-    if (yagi_ui.active == id && IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
-        if (collides_main) {
+    if (yagi_ui.active == id && yagi__mouse_released(MOUSE_BUTTON_LEFT)) {
+        if (collides_main && yagi_ui.focus == id) {
+            yagi_ui.focus = 0;
+        } else if (collides_main) {
             yagi_ui.focus = id;
+            // Open with the selected label in view
+            state->scroll = selected > 0 ? (selected - 1) * rect.height : 0;
+            if (filter != NULL) {
+                filter->query_len = 0;
+                filter->query_dirty = true;
+            }
         }
         yagi_ui.active = 0;
     }
 
+    bool is_open = yagi_ui.focus == id;
+    if (is_open && filter != NULL) {
+        if (filter->labels != labels || filter->label_count != label_count || filter->text == NULL) yagi__dropdown_filter_build(filter, labels, label_count);
+
+        for (size_t i = 0; i < yagi_ui.input.char_count; i++) {
+            int size = 0;
+            const char* bytes = CodepointToUTF8(yagi_ui.input.chars[i], &size);
+            if (filter->query_len + size >= YAGI_DROPDOWN_QUERY_MAX) continue;
+            memcpy(filter->query + filter->query_len, bytes, size);
+            filter->query_len += size;
+            filter->query_dirty = true;
+        }
+        if (filter->query_len > 0 && yagi__key_pressed(KEY_BACKSPACE)) {
+            // Drop a whole UTF-8 sequence
+            do filter->query_len--; while (filter->query_len > 0 && (filter->query[filter->query_len] & 0xc0) == 0x80);
+            filter->query_dirty = true;
+        }
+        if (filter->query_dirty) {
+            yagi__dropdown_filter_update(filter);
+            state->scroll = 0;
+        }
+    }
+
     char* label = selected < 0 ? "Select..." : labels[selected];
-    Vector2 text_size = MeasureTextEx(yagi_ui.style.font, label, yagi_ui.style.font_size, yagi_ui.style.font_spacing);
+    if (is_open && filter != NULL && filter->query_len > 0) {
+        filter->query[filter->query_len] = 0;
+        label = filter->query;
+    }
+    Vector2 text_size = yagi_measure_text(label);
     Color bg = yagi_ui.style.bg_color;
     if (yagi_ui.highlight == id) bg = ColorBrightness(bg, -0.5);
 
-    DrawRectangleRec((Rectangle) { rect.x - 2, rect.y - 2, rect.width + 4, rect.height + 4 }, yagi_ui.style.text_color);
-    DrawRectangleRec(rect, bg);
+    yagi__draw_border((Rectangle) { rect.x - 2, rect.y - 2, rect.width + 4, rect.height + 4 }, 2, yagi_ui.style.text_color);
+    yagi__draw_rect(rect, bg);
 
-    DrawTextEx(yagi_ui.style.font, label, (Vector2) {rect.x + rect.width / 2 - text_size.x / 2, rect.y + rect.height / 2 - 10}, yagi_ui.style.font_size, yagi_ui.style.font_spacing, yagi_ui.style.text_color);
+    yagi__draw_text(label, (Vector2) {rect.x + rect.width / 2 - text_size.x / 2, rect.y + rect.height / 2 - 10}, yagi_ui.style.text_color);
 
     yagi_expand_layout_with_loc((Vector2) { rect.width, rect.height }, file, line);
-    if (yagi_ui.focus == id) {
-        for (size_t i = 0; i < label_count; i++) {
-            Vector2 text_size = MeasureTextEx(yagi_ui.style.font, labels[i], yagi_ui.style.font_size, yagi_ui.style.font_spacing);
-            Rectangle item_rect = { rect.x, rect.y + rect.height * (i + 1), rect.width, rect.height };
-            UIID item_id = yagi_id_next();
 
-            bool collides = CheckCollisionPointRec(mouse, item_rect);
+    bool collides_popup = false;
+    if (is_open) {
+        size_t item_count = filter != NULL ? filter->match_count : label_count;
+        size_t visible_count = item_count < YAGI_DROPDOWN_MAX_VISIBLE ? item_count : YAGI_DROPDOWN_MAX_VISIBLE;
+        float item_height = rect.height;
+        Rectangle popup = { rect.x, rect.y + item_height, rect.width, item_height * visible_count };
+        float max_scroll = item_height * item_count - popup.height;
+
+        uint16_t prev_layer = yagi_ui.layer;
+        yagi_ui.layer = prev_layer + YAGI_LAYER_POPUP;
+        uint16_t parent_clip = yagi__push_clip((Rectangle) { popup.x - 2, popup.y - 2, popup.width + 4, popup.height + 4 });
+
+        // The items are picked by position inside of the popup's hit area, the scrollbar lies on top of it
+        UIID popup_id = yagi__id_combine(id, (uint64_t)label_count + 1);
+        UIID bar_id = yagi__id_combine(id, 0);
+        Rectangle bar = { popup.x + popup.width - 6, popup.y, 6, popup.height };
+        bool collides_items = yagi__hit(popup_id, popup);
+        bool collides_bar = max_scroll > 0 && yagi__hit(bar_id, bar);
+        collides_popup = collides_items || collides_bar;
+
+        Vector2 mouse = yagi_ui.input.mouse;
+        if (collides_popup && !yagi_ui.wheel_consumed) {
+            Vector2 wheel = yagi_ui.input.wheel;
+            if (wheel.y != 0) {
+                state->scroll -= wheel.y * item_height * 3;
+                yagi_ui.wheel_consumed = true;
+            }
+        }
+
+        // Dragging the scrollbar
+        if (collides_bar && yagi_ui.active == 0 && yagi__mouse_pressed(MOUSE_BUTTON_LEFT)) {
+            yagi_ui.active = bar_id;
+        }
+        if (yagi_ui.active == bar_id) {
+            state->scroll = (mouse.y - popup.y) / popup.height * (max_scroll + popup.height) - popup.height / 2;
+            if (yagi__mouse_released(MOUSE_BUTTON_LEFT)) yagi_ui.active = 0;
+        }
+
+        if (state->scroll > max_scroll) state->scroll = max_scroll;
+        if (state->scroll < 0) state->scroll = 0;
+
+        // Only the items inside of the popup are drawn or hit tested
+        size_t first = state->scroll / item_height;
+        size_t last = first + visible_count + 1;
+        if (last > item_count) last = item_count;
+        for (size_t i = first; i < last; i++) {
+            size_t index = filter != NULL ? filter->matches[i] : i;
+            Rectangle item_rect = { popup.x, popup.y + item_height * i - state->scroll, popup.width, item_height };
+            UIID item_id = yagi__id_combine(id, index + 1);
+
+            bool collides = collides_items && yagi_ui.active != bar_id && CheckCollisionPointRec(mouse, item_rect);
             if (collides) {
                 yagi_ui.highlight = item_id;
-                if (yagi_ui.active == 0 && IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
+                if (yagi_ui.active == 0 && yagi__mouse_pressed(MOUSE_BUTTON_LEFT)) {
                     yagi_ui.active = item_id;
                 }
             }
 
-            if (yagi_ui.active == item_id && IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
+            if (yagi_ui.active == item_id && yagi__mouse_released(MOUSE_BUTTON_LEFT)) {
                 if (collides) {
-                    selected = i;
+                    selected = index;
                     changed = true;
                 }
                 yagi_ui.active = 0;
@@ -375,42 +3869,362 @@ bool yagi_dropdown_with_loc(int* already_selected, char* labels[], size_t label_
             Color bg = yagi_ui.style.bg_color;
             if (yagi_ui.highlight == item_id) bg = ColorBrightness(bg, -0.5);
 
-            DrawRectangleRec((Rectangle) { item_rect.x - 2, item_rect.y - 2, item_rect.width + 4, item_rect.height + 4 }, yagi_ui.style.text_color);
-            DrawRectangleRec(item_rect, bg);
+            yagi__draw_border((Rectangle) { item_rect.x - 2, item_rect.y - 2, item_rect.width + 4, item_rect.height + 4 }, 2, yagi_ui.style.text_color);
+            yagi__draw_rect(item_rect, bg);
 
-            DrawTextEx(yagi_ui.style.font, labels[i], (Vector2) {item_rect.x + item_rect.width / 2 - text_size.x / 2, item_rect.y + item_rect.height / 2 - yagi_ui.style.font_size / 2}, yagi_ui.style.font_size, yagi_ui.style.font_spacing, yagi_ui.style.text_color);
-            
-            yagi_expand_layout_with_loc((Vector2) { item_rect.width, item_rect.height }, file, line);
+            Vector2 text_size = yagi_measure_text(labels[index]);
+            yagi__draw_frame_text(labels[index], strlen(labels[index]), (Vector2) {item_rect.x + item_rect.width / 2 - text_size.x / 2, item_rect.y + item_rect.height / 2 - yagi_ui.style.font_size / 2}, yagi_ui.style.text_color);
         }
+
+        if (max_scroll > 0) {
+            float thumb_height = popup.height * popup.height / (item_height * item_count);
+            if (thumb_height < 10) thumb_height = 10;
+            Rectangle thumb = { bar.x, popup.y + (popup.height - thumb_height) * state->scroll / max_scroll, bar.width, thumb_height };
+            yagi__draw_rect(thumb, Fade(yagi_ui.style.text_color, 0.5));
+        }
+
+        yagi_ui.clip = parent_clip;
+        yagi_ui.layer = prev_layer;
+
+        // The popup takes the space of the items it shows
+        yagi_expand_layout_with_loc((Vector2) { popup.width, popup.height }, file, line);
     }
     yagi_end_layout_with_loc(file, line);
 
-    if (yagi_ui.focus == id && !collides_main && IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
+    if (yagi_ui.focus == id && !collides_main && !collides_popup && yagi__mouse_released(MOUSE_BUTTON_LEFT)) {
         yagi_ui.focus = 0;
     }
+    // Picking an item closes the list
+    if (changed) yagi_ui.focus = 0;
 
     *already_selected = selected;
     return changed;
 }
 
+bool yagi_dropdown_with_loc(int* already_selected, char* labels[], size_t label_count, const char* file, int line) {
+    YAGI__STAT_WIDGET_BEGIN();
+    bool result = yagi__dropdown(already_selected, labels, label_count, NULL, file, line);
+    YAGI__STAT_WIDGET_END(YAGI_WIDGET_DROPDOWN);
+    return result;
+}
 
-bool yagi_input_with_loc(int width, InputBuffer* input_buffer, const char* file, int line) {
+bool yagi_dropdown_filtered_with_loc(int* already_selected, char* labels[], size_t label_count, YagiDropdownFilter* filter, const char* file, int line) {
+    YAGI__STAT_WIDGET_BEGIN();
+    bool result = yagi__dropdown(already_selected, labels, label_count, filter, file, line);
+    YAGI__STAT_WIDGET_END(YAGI_WIDGET_DROPDOWN);
+    return result;
+}
+
+
+static float yagi__codepoint_advance(const YagiStyle* style, int codepoint) {
+    if (style->dynamic_font != NULL) {
+        yagi__font_lock(style->dynamic_font);
+        YagiFontSize* size = yagi__font_size(style->dynamic_font, (int)(style->font_size + 0.5f));
+        float advance = yagi__font_glyph(style->dynamic_font, size, codepoint)->advance_x;
+        yagi__font_unlock(style->dynamic_font);
+        return advance;
+    }
+
+    return yagi__backend()->codepoint_advance(style->font, codepoint, style->font_size);
+}
+
+static int yagi__input_buffer_at(const InputBuffer* self, size_t i) {
+    if (i < self->gap_start) return self->codepoints[i];
+    return self->codepoints[i + (self->gap_end - self->gap_start)];
+}
+
+static float yagi__input_buffer_x(const InputBuffer* self, size_t i) {
+    if (i < self->gap_start) return self->xs[i];
+    if (i >= self->count) return self->width;
+    return self->width - self->xs[i + (self->gap_end - self->gap_start)];
+}
+
+static void yagi__input_buffer_reserve(InputBuffer* self, size_t extra) {
+    if (self->gap_end - self->gap_start >= extra) return;
+
+    size_t capacity = self->capacity == 0 ? 16 : self->capacity;
+    while (capacity - self->count < extra) capacity *= 2;
+
+    size_t tail = self->capacity - self->gap_end;
+    self->codepoints = YAGI_REALLOC(self->codepoints, sizeof(*self->codepoints) * capacity);
+    self->xs = YAGI_REALLOC(self->xs, sizeof(*self->xs) * capacity);
+    assert(self->codepoints != NULL && self->xs != NULL);
+    memmove(self->codepoints + capacity - tail, self->codepoints + self->gap_end, sizeof(*self->codepoints) * tail);
+    memmove(self->xs + capacity - tail, self->xs + self->gap_end, sizeof(*self->xs) * tail);
+
+    self->gap_end = capacity - tail;
+    self->capacity = capacity;
+}
+
+static void yagi__input_buffer_move_gap(InputBuffer* self, size_t pos) {
+    while (self->gap_start > pos) {
+        self->gap_start--;
+        self->gap_end--;
+        self->codepoints[self->gap_end] = self->codepoints[self->gap_start];
+        self->xs[self->gap_end] = self->width - self->xs[self->gap_start];
+    }
+    while (self->gap_start < pos) {
+        self->codepoints[self->gap_start] = self->codepoints[self->gap_end];
+        self->xs[self->gap_start] = self->width - self->xs[self->gap_end];
+        self->gap_start++;
+        self->gap_end++;
+    }
+}
+
+// Recomputes every x position, only needed when the font changes
+static void yagi__input_buffer_measure(InputBuffer* self, const YagiStyle* style) {
+    unsigned int font_id = style->dynamic_font != NULL ? style->dynamic_font->id : style->font.texture.id;
+    if (self->font_id == font_id && self->font_size == style->font_size && self->font_spacing == style->font_spacing) return;
+    self->font_id = font_id;
+    self->font_size = style->font_size;
+    self->font_spacing = style->font_spacing;
+
+    float x = 0;
+    for (size_t i = 0; i < self->gap_start; i++) {
+        self->xs[i] = x;
+        x += yagi__codepoint_advance(style, self->codepoints[i]) + style->font_spacing;
+    }
+    for (size_t i = self->gap_end; i < self->capacity; i++) {
+        self->xs[i] = x;
+        x += yagi__codepoint_advance(style, self->codepoints[i]) + style->font_spacing;
+    }
+    self->width = x;
+    for (size_t i = self->gap_end; i < self->capacity; i++) {
+        self->xs[i] = self->width - self->xs[i];
+    }
+}
+
+static void yagi__input_buffer_insert(InputBuffer* self, const YagiStyle* style, int codepoint) {
+    yagi__input_buffer_reserve(self, 1);
+    yagi__input_buffer_move_gap(self, self->cursor);
+
+    float x = yagi__input_buffer_x(self, self->cursor);
+    self->codepoints[self->gap_start] = codepoint;
+    self->xs[self->gap_start] = x;
+    self->gap_start++;
+    self->count++;
+    self->width += yagi__codepoint_advance(style, codepoint) + style->font_spacing;
+
+    self->cursor++;
+    self->anchor = self->cursor;
+}
+
+static void yagi__input_buffer_delete(InputBuffer* self, size_t begin, size_t end) {
+    if (begin >= end) return;
+
+    yagi__input_buffer_move_gap(self, begin);
+    self->width -= yagi__input_buffer_x(self, end) - yagi__input_buffer_x(self, begin);
+    self->gap_end += end - begin;
+    self->count -= end - begin;
+
+    self->cursor = self->anchor = begin;
+}
+
+static bool yagi__input_buffer_delete_selection(InputBuffer* self) {
+    if (self->cursor == self->anchor) return false;
+    size_t begin = self->cursor < self->anchor ? self->cursor : self->anchor;
+    size_t end = self->cursor < self->anchor ? self->anchor : self->cursor;
+    yagi__input_buffer_delete(self, begin, end);
+    return true;
+}
+
+static bool yagi__is_space(int codepoint) {
+    return codepoint == ' ' || codepoint == '\t';
+}
+
+static size_t yagi__input_buffer_word_left(const InputBuffer* self, size_t i) {
+    while (i > 0 && yagi__is_space(yagi__input_buffer_at(self, i - 1))) i--;
+    while (i > 0 && !yagi__is_space(yagi__input_buffer_at(self, i - 1))) i--;
+    return i;
+}
+
+static size_t yagi__input_buffer_word_right(const InputBuffer* self, size_t i) {
+    while (i < self->count && !yagi__is_space(yagi__input_buffer_at(self, i))) i++;
+    while (i < self->count && yagi__is_space(yagi__input_buffer_at(self, i))) i++;
+    return i;
+}
+
+// Returns the index of the cursor position closest to x
+static size_t yagi__input_buffer_hit(const InputBuffer* self, float x) {
+    size_t lo = 0, hi = self->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (yagi__input_buffer_x(self, mid) < x) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo > 0 && x - yagi__input_buffer_x(self, lo - 1) < yagi__input_buffer_x(self, lo) - x) lo--;
+    return lo;
+}
+
+static void yagi__input_buffer_copy(const InputBuffer* self) {
+    size_t begin = self->cursor < self->anchor ? self->cursor : self->anchor;
+    size_t end = self->cursor < self->anchor ? self->anchor : self->cursor;
+
+    char* utf8 = yagi_frame_alloc((end - begin) * 4 + 1);
+    size_t len = 0;
+    for (size_t i = begin; i < end; i++) {
+        int size = 0;
+        const char* bytes = CodepointToUTF8(yagi__input_buffer_at(self, i), &size);
+        memcpy(utf8 + len, bytes, size);
+        len += size;
+    }
+    utf8[len] = 0;
+
+    if (!yagi_ui.deferred) {
+        yagi__backend()->set_clipboard(utf8);
+        return;
+    }
+    if (len + 1 > yagi_ui.copy_capacity) {
+        yagi_ui.copy_capacity = len + 1;
+        yagi_ui.copy_text = YAGI_REALLOC(yagi_ui.copy_text, yagi_ui.copy_capacity);
+        assert(yagi_ui.copy_text != NULL);
+    }
+    memcpy(yagi_ui.copy_text, utf8, len + 1);
+    yagi_ui.copy_set = true;
+}
+
+static void yagi__input_buffer_paste(InputBuffer* self, const YagiStyle* style, const char* text) {
+    if (text == NULL) return;
+    while (*text != 0) {
+        int size = 0;
+        int codepoint = GetCodepointNext(text, &size);
+        text += size;
+        if (codepoint >= ' ') yagi__input_buffer_insert(self, style, codepoint);
+    }
+}
+
+static bool yagi__input_buffer_handle_keys(InputBuffer* self, const YagiStyle* style) {
+    bool ctrl = yagi__key_down(KEY_LEFT_CONTROL) || yagi__key_down(KEY_RIGHT_CONTROL);
+    bool shift = yagi__key_down(KEY_LEFT_SHIFT) || yagi__key_down(KEY_RIGHT_SHIFT);
     bool changed = false;
-    UIID id = yagi_id_next();
 
-    Vector2 pos = yagi_next_widget_pos_with_loc(file, line);
-    Rectangle rect = { pos.x, pos.y, width, yagi_ui.style.font_size };
+    // All of the characters typed since the last frame, so fast typing and IME bursts are kept.
+    // Keys pressed in the same frame apply after them.
+    for (size_t i = 0; i < yagi_ui.input.char_count; i++) {
+        int codepoint = yagi_ui.input.chars[i];
+        if (codepoint < ' ') continue;
+        if (!changed) yagi__input_buffer_delete_selection(self);
+        yagi__input_buffer_insert(self, style, codepoint);
+        changed = true;
+    }
+
+    bool has_selection = self->cursor != self->anchor;
+    size_t selection_begin = self->cursor < self->anchor ? self->cursor : self->anchor;
+    size_t selection_end = self->cursor < self->anchor ? self->anchor : self->cursor;
+    size_t cursor = self->cursor;
+    bool moved = true;
+    if (yagi__key_pressed(KEY_LEFT)) {
+        if (has_selection && !shift) cursor = selection_begin;
+        else if (ctrl) cursor = yagi__input_buffer_word_left(self, cursor);
+        else if (cursor > 0) cursor--;
+    } else if (yagi__key_pressed(KEY_RIGHT)) {
+        if (has_selection && !shift) cursor = selection_end;
+        else if (ctrl) cursor = yagi__input_buffer_word_right(self, cursor);
+        else if (cursor < self->count) cursor++;
+    } else if (yagi__key_pressed_once(KEY_HOME)) {
+        cursor = 0;
+    } else if (yagi__key_pressed_once(KEY_END)) {
+        cursor = self->count;
+    } else {
+        moved = false;
+    }
+
+    if (moved) {
+        self->cursor = cursor;
+        if (!shift) self->anchor = cursor;
+        return changed;
+    }
+
+    if (yagi__key_pressed(KEY_BACKSPACE)) {
+        if (!yagi__input_buffer_delete_selection(self) && self->cursor > 0) {
+            size_t begin = ctrl ? yagi__input_buffer_word_left(self, self->cursor) : self->cursor - 1;
+            yagi__input_buffer_delete(self, begin, self->cursor);
+        }
+        changed = true;
+    } else if (yagi__key_pressed(KEY_DELETE)) {
+        if (!yagi__input_buffer_delete_selection(self) && self->cursor < self->count) {
+            size_t end = ctrl ? yagi__input_buffer_word_right(self, self->cursor) : self->cursor + 1;
+            yagi__input_buffer_delete(self, self->cursor, end);
+        }
+        changed = true;
+    } else if (ctrl && yagi__key_pressed_once(KEY_A)) {
+        self->anchor = 0;
+        self->cursor = self->count;
+    } else if (ctrl && (yagi__key_pressed_once(KEY_C) || yagi__key_pressed_once(KEY_X)) && has_selection) {
+        yagi__input_buffer_copy(self);
+        if (yagi__key_pressed_once(KEY_X) && yagi__input_buffer_delete_selection(self)) changed = true;
+    } else if (ctrl && yagi__key_pressed(KEY_V)) {
+        yagi__input_buffer_delete_selection(self);
+        yagi__input_buffer_paste(self, style, yagi__clipboard());
+        changed = true;
+    }
+
+    return changed;
+}
+
+const int* yagi_input_buffer_codepoints(InputBuffer* self) {
+    yagi__input_buffer_move_gap(self, self->count);
+    return self->codepoints;
+}
+
+void yagi_input_buffer_set_text(InputBuffer* self, const char* text) {
+    self->gap_start = 0;
+    self->gap_end = self->capacity;
+    self->count = 0;
+    self->width = 0;
+    self->cursor = self->anchor = 0;
+    self->scroll = 0;
+
+    while (*text != 0) {
+        int size = 0;
+        int codepoint = GetCodepointNext(text, &size);
+        text += size;
+
+        yagi__input_buffer_reserve(self, 1);
+        self->codepoints[self->gap_start++] = codepoint;
+        self->count++;
+    }
+    self->cursor = self->anchor = self->count;
+
+    // Measured by the next yagi_input that draws it
+    self->font_id = 0;
+    self->font_size = 0;
+}
+
+void yagi_input_buffer_free(InputBuffer* self) {
+    YAGI_FREE(self->codepoints);
+    YAGI_FREE(self->xs);
+    *self = (InputBuffer) {0};
+}
+
+static bool yagi__input(int width, InputBuffer* input_buffer, const char* file, int line) {
+    bool changed = false;
+    UIID id = yagi_id_with_loc(file, line);
+
+    if (yagi_ui.active != id && yagi_ui.focus != id && yagi__cull_with_loc((Vector2) { width, yagi_ui.style.font_size }, file, line)) return false;
 
-    Vector2 mouse = GetMousePosition();
-    bool collides = CheckCollisionPointRec(mouse, rect);
+    Rectangle rect = yagi__place_with_loc((Vector2) { width, yagi_ui.style.font_size }, file, line);
+    width = rect.width;
+    yagi__input_buffer_measure(input_buffer, &yagi_ui.style);
+
+    Vector2 mouse = yagi_ui.input.mouse;
+    bool collides = yagi__hit(id, rect);
+    bool pressed = false;
     if (collides) {
         yagi_ui.highlight = id;
-        if (yagi_ui.active == 0 && IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
+        if (yagi_ui.active == 0 && yagi__mouse_pressed(MOUSE_BUTTON_LEFT)) {
             yagi_ui.active = id;
+            pressed = true;
         }
     }
 
-    if (yagi_ui.active == id && IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
+    // Clicking places the cursor, dragging selects
+    if (yagi_ui.active == id && yagi__mouse_down(MOUSE_BUTTON_LEFT)) {
+        input_buffer->cursor = yagi__input_buffer_hit(input_buffer, mouse.x - rect.x + input_buffer->scroll);
+        if (pressed && !yagi__key_down(KEY_LEFT_SHIFT) && !yagi__key_down(KEY_RIGHT_SHIFT)) input_buffer->anchor = input_buffer->cursor;
+    }
+
+    if (yagi_ui.active == id && yagi__mouse_released(MOUSE_BUTTON_LEFT)) {
         if (collides) {
             yagi_ui.focus = id;
         }
@@ -419,76 +4233,96 @@ bool yagi_input_with_loc(int width, InputBuffer* input_buffer, const char* file,
 
     bool is_focused = yagi_ui.focus == id;
     if (is_focused) {
-        int key = GetCharPressed();
-        if (key >= ' ') {
-            yagi__input_buffer_push(input_buffer, key);
-            changed = true;
-        }
-
-        if ((IsKeyPressed(KEY_BACKSPACE) || IsKeyPressedRepeat(KEY_BACKSPACE)) && input_buffer->count > 0) {
-            input_buffer->count--;
-            changed = true;
-        }
+        changed = yagi__input_buffer_handle_keys(input_buffer, &yagi_ui.style);
     }
 
-    if (is_focused) DrawRectangle(rect.x - 2, rect.y - 2, rect.width + 4, rect.height + 4, yagi_ui.style.text_color);
-    DrawRectangleRec(rect, yagi_ui.style.bg_color);
+    // Keep the cursor inside of the widget
+    float cursor_x = yagi__input_buffer_x(input_buffer, input_buffer->cursor);
+    if (cursor_x - input_buffer->scroll > width - 2) input_buffer->scroll = cursor_x - width + 2;
+    if (cursor_x < input_buffer->scroll) input_buffer->scroll = cursor_x;
+    float max_scroll = input_buffer->width - width + 2;
+    if (input_buffer->scroll > max_scroll) input_buffer->scroll = max_scroll > 0 ? max_scroll : 0;
+
+    if (is_focused) yagi__draw_border((Rectangle) { rect.x - 2, rect.y - 2, rect.width + 4, rect.height + 4 }, 2, yagi_ui.style.text_color);
+    yagi__draw_rect(rect, yagi_ui.style.bg_color);
+
+    uint16_t parent_clip = yagi__push_clip(rect);
+    float origin = rect.x - input_buffer->scroll;
 
-    size_t codepoint_offset = 0;
+    if (input_buffer->cursor != input_buffer->anchor) {
+        float x0 = yagi__input_buffer_x(input_buffer, input_buffer->cursor);
+        float x1 = yagi__input_buffer_x(input_buffer, input_buffer->anchor);
+        if (x0 > x1) { float x = x0; x0 = x1; x1 = x; }
+        yagi__draw_rect((Rectangle) { origin + x0, rect.y, x1 - x0, rect.height }, Fade(yagi_ui.style.text_color, 0.25));
+    }
 
-    char* utf8 = yagi_utf8_temp(input_buffer->codepoints + codepoint_offset, input_buffer->count - codepoint_offset);
-    Vector2 text_size = MeasureTextEx(yagi_ui.style.font, utf8, yagi_ui.style.font_size, yagi_ui.style.font_spacing);
-    while (codepoint_offset < input_buffer->count && text_size.x > width) {
-        codepoint_offset++;
+    // Only the visible codepoints are drawn, in at most two runs around the gap
+    size_t first = yagi__input_buffer_hit(input_buffer, input_buffer->scroll);
+    if (first > 0 && yagi__input_buffer_x(input_buffer, first) > input_buffer->scroll) first--;
+    size_t last = yagi__input_buffer_hit(input_buffer, input_buffer->scroll + width);
+    if (last < input_buffer->count) last++;
 
-        utf8 = yagi_utf8_temp(input_buffer->codepoints + codepoint_offset, input_buffer->count - codepoint_offset);
-        text_size = MeasureTextEx(yagi_ui.style.font, utf8, yagi_ui.style.font_size, yagi_ui.style.font_spacing);
+    size_t gap = input_buffer->gap_end - input_buffer->gap_start;
+    if (first < input_buffer->gap_start) {
+        size_t end = last < input_buffer->gap_start ? last : input_buffer->gap_start;
+        yagi__draw_codepoints(input_buffer->codepoints + first, end - first, (Vector2){ origin + yagi__input_buffer_x(input_buffer, first), rect.y }, yagi_ui.style.text_color);
+    }
+    if (last > input_buffer->gap_start) {
+        size_t begin = first > input_buffer->gap_start ? first : input_buffer->gap_start;
+        yagi__draw_codepoints(input_buffer->codepoints + begin + gap, last - begin, (Vector2){ origin + yagi__input_buffer_x(input_buffer, begin), rect.y }, yagi_ui.style.text_color);
     }
 
-    Rectangle cursor = { rect.x + text_size.x, rect.y, 2, yagi_ui.style.font_size };
-    DrawTextCodepoints(yagi_ui.style.font, input_buffer->codepoints + codepoint_offset, input_buffer->count - codepoint_offset, (Vector2){ rect.x, rect.y }, yagi_ui.style.font_size, yagi_ui.style.font_spacing, yagi_ui.style.text_color);
-    if (is_focused) DrawRectangleRec(cursor, yagi_ui.style.text_color);
+    if (is_focused) yagi__draw_rect((Rectangle) { origin + cursor_x, rect.y, 2, yagi_ui.style.font_size }, yagi_ui.style.text_color);
+    yagi_ui.clip = parent_clip;
 
-    if (!collides && IsMouseButtonReleased(MOUSE_BUTTON_LEFT) && yagi_ui.focus == id) yagi_ui.focus = 0;
+    if (!collides && yagi__mouse_released(MOUSE_BUTTON_LEFT) && yagi_ui.focus == id) yagi_ui.focus = 0;
     
-    yagi_expand_layout_with_loc((Vector2){width, yagi_ui.style.font_size}, file, line);
+    yagi_expand_layout_with_loc((Vector2) { rect.width, rect.height }, file, line);
 
     return changed;
 }
 
-bool yagi_slider_with_loc(int width, float* value_ptr, const char* file, int line) {
-    UIID id = yagi_id_next();
+bool yagi_input_with_loc(int width, InputBuffer* input_buffer, const char* file, int line) {
+    YAGI__STAT_WIDGET_BEGIN();
+    bool result = yagi__input(width, input_buffer, file, line);
+    YAGI__STAT_WIDGET_END(YAGI_WIDGET_INPUT);
+    return result;
+}
+
+static bool yagi__slider(int width, float* value_ptr, const char* file, int line) {
+    UIID id = yagi_id_with_loc(file, line);
 
     float value = *value_ptr;
     bool changed = false;
 
-    Vector2 pos = yagi_next_widget_pos_with_loc(file, line);
-    Rectangle rect = { pos.x, pos.y, width, 4 };
-    Vector2 ball_pos = { rect.x + width * value, rect.y + rect.height / 2 };
+    if (yagi_ui.active != id && yagi__cull_with_loc((Vector2) { width, 4 }, file, line)) return false;
+
+    Rectangle rect = yagi__place_with_loc((Vector2) { width, 4 }, file, line);
+    Vector2 ball_pos = { rect.x + rect.width * value, rect.y + rect.height / 2 };
     float ball_r = rect.height * 2;
 
-    Vector2 mouse = GetMousePosition();
-    bool collides_with_ball = CheckCollisionPointCircle(mouse, ball_pos, ball_r);
+    Rectangle ball_rect = { ball_pos.x - ball_r, ball_pos.y - ball_r, ball_r * 2, ball_r * 2 };
+    bool collides_with_ball = yagi__hit(id, ball_rect) && CheckCollisionPointCircle(yagi_ui.input.mouse, ball_pos, ball_r);
     if (collides_with_ball) {
         yagi_ui.highlight = id;
-        if (yagi_ui.active == 0 && IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
+        if (yagi_ui.active == 0 && yagi__mouse_pressed(MOUSE_BUTTON_LEFT)) {
             yagi_ui.active = id;
         }
     }
 
-    if (yagi_ui.active == id && IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
+    if (yagi_ui.active == id && yagi__mouse_released(MOUSE_BUTTON_LEFT)) {
         yagi_ui.active = 0;
     }
 
-    DrawRectangle(rect.x - 2, rect.y - 2, rect.width + 4, rect.height + 4, yagi_ui.style.text_color);
-    DrawRectangleRec(rect, yagi_ui.style.bg_color);
+    yagi__draw_border((Rectangle) { rect.x - 2, rect.y - 2, rect.width + 4, rect.height + 4 }, 2, yagi_ui.style.text_color);
+    yagi__draw_rect(rect, yagi_ui.style.bg_color);
 
     Color circle_color = yagi_ui.style.text_color;
     if (yagi_ui.highlight == id) circle_color = ColorBrightness(circle_color, 0.5);
-    DrawCircleV(ball_pos, ball_r, circle_color);
+    yagi__draw_circle(ball_pos, ball_r, circle_color);
 
     if (yagi_ui.active == id) {
-        Vector2 mouse_delta = GetMouseDelta();
+        Vector2 mouse_delta = yagi_ui.input.mouse_delta;
         value = (ball_pos.x - rect.x + mouse_delta.x) / rect.width;
         if (value < 0) value = 0;
         if (value > 1) value = 1;
@@ -501,26 +4335,35 @@ bool yagi_slider_with_loc(int width, float* value_ptr, const char* file, int lin
     return changed;
 }
 
-bool yagi_checkbox_with_loc(Vector2 size, bool* checked_ptr, const char* file, int line) {
+bool yagi_slider_with_loc(int width, float* value_ptr, const char* file, int line) {
+    YAGI__STAT_WIDGET_BEGIN();
+    bool result = yagi__slider(width, value_ptr, file, line);
+    YAGI__STAT_WIDGET_END(YAGI_WIDGET_SLIDER);
+    return result;
+}
+
+static bool yagi__checkbox(Vector2 size, bool* checked_ptr, const char* file, int line) {
     bool checked = *checked_ptr;
     bool changed = false;
-    UIID id = yagi_id_next();
+    UIID id = yagi_id_with_loc(file, line);
 
-    Vector2 pos = yagi_next_widget_pos_with_loc(file, line);
-    Rectangle rect = { pos.x, pos.y, size.x, size.y };
-    Rectangle border_rect = { rect.x - 2, rect.y - 2, rect.width + 4, rect.height + 4 };
+    if (yagi_ui.active != id && yagi__cull_with_loc((Vector2) { size.x + 4, size.y + 4 }, file, line)) return false;
 
-    Vector2 mouse = GetMousePosition();
-    bool collides = CheckCollisionPointRec(mouse, border_rect);
+    Rectangle border_rect = yagi__place_with_loc((Vector2) { size.x + 4, size.y + 4 }, file, line);
+    border_rect.x -= 2;
+    border_rect.y -= 2;
+    Rectangle rect = { border_rect.x + 2, border_rect.y + 2, border_rect.width - 4, border_rect.height - 4 };
+
+    bool collides = yagi__hit(id, border_rect);
     if (collides) {
         yagi_ui.highlight = id;
-        if (yagi_ui.active == 0 && IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
+        if (yagi_ui.active == 0 && yagi__mouse_pressed(MOUSE_BUTTON_LEFT)) {
             yagi_ui.active = id;
         }
     }
 
     if (yagi_ui.active == id) {
-        if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
+        if (yagi__mouse_released(MOUSE_BUTTON_LEFT)) {
             if (collides) {
                 checked = !checked;
                 changed = true;
@@ -529,12 +4372,12 @@ bool yagi_checkbox_with_loc(Vector2 size, bool* checked_ptr, const char* file, i
         }
     }
 
-    DrawRectangleRec(border_rect, BLACK);
+    yagi__draw_border(border_rect, 2, BLACK);
 
     Color bg = yagi_ui.style.bg_color;
     if (checked) bg = BLUE;
     if (yagi_ui.highlight == id) bg = ColorBrightness(bg, -0.5);
-    DrawRectangleRec(rect, bg);
+    yagi__draw_rect(rect, bg);
 
     yagi_expand_layout_with_loc((Vector2) { border_rect.width, border_rect.height }, file, line);
 
@@ -542,4 +4385,374 @@ bool yagi_checkbox_with_loc(Vector2 size, bool* checked_ptr, const char* file, i
     return changed;
 }
 
+bool yagi_checkbox_with_loc(Vector2 size, bool* checked_ptr, const char* file, int line) {
+    YAGI__STAT_WIDGET_BEGIN();
+    bool result = yagi__checkbox(size, checked_ptr, file, line);
+    YAGI__STAT_WIDGET_END(YAGI_WIDGET_CHECKBOX);
+    return result;
+}
+
+static void yagi__table(Vector2 size, YagiTable* table, YagiScroll* scroll, const char* file, int line) {
+    UIID id = yagi_id_with_loc(file, line);
+    if (yagi__cull_with_loc(size, file, line)) return;
+
+    Rectangle rect = yagi__place_with_loc(size, file, line);
+    float row_height = table->row_height > 0 ? table->row_height : yagi_ui.style.font_size + YAGI_TABLE_CELL_PADDING * 2;
+    float header_height = row_height < rect.height ? row_height : rect.height;
+    Rectangle header = { rect.x, rect.y, rect.width, header_height };
+    Rectangle body = { rect.x, rect.y + header_height, rect.width, rect.height - header_height };
+
+    float content_width = 0;
+    for (size_t i = 0; i < table->column_count; i++) {
+        if (table->columns[i].width < YAGI_TABLE_MIN_COLUMN_WIDTH) table->columns[i].width = YAGI_TABLE_MIN_COLUMN_WIDTH;
+        content_width += table->columns[i].width;
+    }
+    scroll->content_size = (Vector2) { content_width, row_height * table->row_count };
+    Vector2 max_offset = { scroll->content_size.x - body.width, scroll->content_size.y - body.height };
+
+    UIID bar_id = yagi__id_combine(id, 0);
+    Rectangle bar = { body.x + body.width - 6, body.y, 6, body.height };
+    bool collides = yagi__hit(id, rect);
+    bool collides_bar = max_offset.y > 0 && yagi__hit(bar_id, bar);
+    Vector2 mouse = yagi_ui.input.mouse;
+
+    if ((collides || collides_bar) && !yagi_ui.wheel_consumed) {
+        Vector2 wheel = yagi_ui.input.wheel;
+        // Shift turns the wheel sideways
+        if (yagi__key_down(KEY_LEFT_SHIFT) || yagi__key_down(KEY_RIGHT_SHIFT)) wheel = (Vector2) { wheel.y, wheel.x };
+        if (wheel.x != 0 || wheel.y != 0) {
+            scroll->offset.x -= wheel.x * yagi_ui.style.font_size * 2;
+            scroll->offset.y -= wheel.y * yagi_ui.style.font_size * 2;
+            yagi_ui.wheel_consumed = true;
+        }
+    }
+
+    if (collides_bar && yagi_ui.active == 0 && yagi__mouse_pressed(MOUSE_BUTTON_LEFT)) {
+        yagi_ui.active = bar_id;
+    }
+    if (yagi_ui.active == bar_id) {
+        scroll->offset.y = (mouse.y - body.y) / body.height * scroll->content_size.y - body.height / 2;
+        if (yagi__mouse_released(MOUSE_BUTTON_LEFT)) yagi_ui.active = 0;
+    }
+
+    if (scroll->offset.x > max_offset.x) scroll->offset.x = max_offset.x;
+    if (scroll->offset.y > max_offset.y) scroll->offset.y = max_offset.y;
+    if (scroll->offset.x < 0) scroll->offset.x = 0;
+    if (scroll->offset.y < 0) scroll->offset.y = 0;
+
+    // Columns are resized by dragging the right edge of their header
+    float x = rect.x - scroll->offset.x;
+    for (size_t i = 0; i < table->column_count; i++) {
+        YagiTableColumn* column = &table->columns[i];
+        UIID edge_id = yagi__id_combine(id, i + 1);
+        Rectangle edge = { x + column->width - 3, header.y, 6, header.height };
+        if (yagi__hit(edge_id, edge)) {
+            yagi_ui.highlight = edge_id;
+            if (yagi_ui.active == 0 && yagi__mouse_pressed(MOUSE_BUTTON_LEFT)) yagi_ui.active = edge_id;
+        }
+        if (yagi_ui.active == edge_id) {
+            column->width = mouse.x - x;
+            if (column->width < YAGI_TABLE_MIN_COLUMN_WIDTH) column->width = YAGI_TABLE_MIN_COLUMN_WIDTH;
+            if (yagi__mouse_released(MOUSE_BUTTON_LEFT)) yagi_ui.active = 0;
+        }
+        x += column->width;
+    }
+
+    Color line_color = Fade(yagi_ui.style.text_color, 0.3);
+    yagi__draw_border((Rectangle) { rect.x - 2, rect.y - 2, rect.width + 4, rect.height + 4 }, 2, yagi_ui.style.text_color);
+    yagi__draw_rect(rect, yagi_ui.style.bg_color);
+    yagi__draw_rect(header, ColorBrightness(yagi_ui.style.bg_color, -0.1));
+
+    size_t first = scroll->offset.y / row_height;
+    size_t last = first + (size_t)(body.height / row_height) + 2;
+    if (first > table->row_count) first = table->row_count;
+    if (last > table->row_count) last = table->row_count;
+    float text_y = (row_height - yagi_ui.style.font_size) / 2;
+
+    // Column by column, every column clips its cells
+    uint16_t parent_clip = yagi_ui.clip;
+    char buf[YAGI_TABLE_CELL_MAX];
+    x = rect.x - scroll->offset.x;
+    for (size_t i = 0; i < table->column_count && x < rect.x + rect.width; i++) {
+        const YagiTableColumn* column = &table->columns[i];
+        Rectangle column_rect = { x, rect.y, column->width, rect.height };
+        x += column->width;
+        if (column_rect.x + column_rect.width <= rect.x) continue;
+
+        yagi__push_clip(yagi__rect_intersect(column_rect, header));
+        if (column->title != NULL) yagi__draw_text(column->title, (Vector2) { column_rect.x + YAGI_TABLE_CELL_PADDING, header.y + text_y }, yagi_ui.style.text_color);
+        yagi_ui.clip = parent_clip;
+
+        yagi__push_clip(yagi__rect_intersect(column_rect, body));
+        for (size_t row = first; row < last; row++) {
+            const char* text = table->cell(table->user, row, i, buf, sizeof(buf));
+            if (text == NULL) continue;
+
+            Vector2 pos = { column_rect.x + YAGI_TABLE_CELL_PADDING, body.y + row * row_height - scroll->offset.y + text_y };
+            if (text == buf) yagi__draw_text(text, pos, yagi_ui.style.text_color);
+            else yagi__draw_frame_text(text, strlen(text), pos, yagi_ui.style.text_color);
+        }
+        yagi_ui.clip = parent_clip;
+
+        Color edge_color = yagi_ui.highlight == yagi__id_combine(id, i + 1) || yagi_ui.active == yagi__id_combine(id, i + 1) ? yagi_ui.style.text_color : line_color;
+        yagi__draw_rect((Rectangle) { column_rect.x + column_rect.width - 1, rect.y, 1, rect.height }, edge_color);
+    }
+    yagi__draw_rect((Rectangle) { rect.x, header.y + header.height - 1, rect.width, 1 }, yagi_ui.style.text_color);
+
+    if (max_offset.y > 0) {
+        float thumb_height = body.height * body.height / scroll->content_size.y;
+        if (thumb_height < 10) thumb_height = 10;
+        Rectangle thumb = { bar.x, body.y + (body.height - thumb_height) * scroll->offset.y / max_offset.y, bar.width, thumb_height };
+        yagi__draw_rect(thumb, Fade(yagi_ui.style.text_color, 0.5));
+    }
+
+    yagi_expand_layout_with_loc((Vector2) { rect.width, rect.height }, file, line);
+}
+
+void yagi_table_with_loc(Vector2 size, YagiTable* table, YagiScroll* scroll, const char* file, int line) {
+    YAGI__STAT_WIDGET_BEGIN();
+    yagi__table(size, table, scroll, file, line);
+    YAGI__STAT_WIDGET_END(YAGI_WIDGET_TABLE);
+}
+
+#ifndef YAGI_NO_STATS
+static void yagi__stats_line(const char* name, YagiStatRange range, const char* file, int line) {
+    yagi_text_with_loc(file, line, "%-16s %10.3f %10.3f %10.3f", name, range.min, range.avg, range.p99);
+}
+
+#endif // YAGI_NO_STATS
+
+void yagi_stats_overlay_with_loc(const char* file, int line) {
+#ifdef YAGI_NO_STATS
+    yagi_text_with_loc(file, line, "stats disabled (YAGI_NO_STATS)");
+#else
+    static const char* widget_names[YAGI_WIDGET_KIND_COUNT] = {
+        "text ms", "empty ms", "button ms", "dropdown ms", "input ms", "slider ms", "checkbox ms", "table ms",
+    };
+    YagiStats stats = yagi_ui_stats();
+
+    yagi_begin_sublayout_with_loc(LAYOUT_VERT, 2, file, line);
+    yagi_text_with_loc(file, line, "%-16s %10s %10s %10s", "last frames", "min", "avg", "p99");
+    yagi__stats_line("frame ms", stats.frame_ms, file, line);
+    yagi__stats_line("frame time ms", stats.frame_time_ms, file, line);
+    if (stats.last.logged_frame_time_ms > 0) yagi__stats_line("logged time ms", stats.logged_frame_time_ms, file, line);
+    yagi__stats_line("widgets", stats.widgets, file, line);
+    yagi__stats_line("draw calls", stats.draw_calls, file, line);
+    yagi__stats_line("text measures", stats.text_measures, file, line);
+    yagi__stats_line("measure misses", stats.measure_misses, file, line);
+    yagi__stats_line("bytes formatted", stats.bytes_formatted, file, line);
+    yagi__stats_line("peak layouts", stats.peak_layout_count, file, line);
+    for (size_t kind = 0; kind < YAGI_WIDGET_KIND_COUNT; kind++) {
+        if (stats.last.widgets[kind] == 0) continue;
+        yagi__stats_line(widget_names[kind], stats.widget_ms[kind], file, line);
+    }
+    yagi_end_layout_with_loc(file, line);
+#endif // YAGI_NO_STATS
+}
+
+YagiContext* yagi_ctx_create() {
+    YagiContext* ctx = yagi__calloc(1, sizeof(*ctx));
+    assert(ctx != NULL);
+    return ctx;
+}
+
+void yagi_ctx_destroy(YagiContext* ctx) {
+    if (ctx == NULL || ctx == &yagi__default_ctx) return;
+    if (yagi__current_ctx == ctx) yagi__current_ctx = &yagi__default_ctx;
+
+    YAGI_FREE(ctx->states);
+    YAGI_FREE(ctx->states_spare);
+    for (size_t i = 0; i < ctx->state_chunk_count; i++) YAGI_FREE(ctx->state_chunks[i]);
+    YAGI_FREE(ctx->state_chunks);
+    YAGI_FREE(ctx->cmds);
+    YAGI_FREE(ctx->cmd_keys);
+    YAGI_FREE(ctx->hits);
+    YAGI_FREE(ctx->prev_hits);
+    YAGI_FREE(ctx->grid_cells);
+    YAGI_FREE(ctx->grid_items);
+    YAGI_FREE(ctx->log_clipboard);
+    YAGI_FREE(ctx->copy_text);
+    for (size_t i = 0; i < YAGI_QUAD_STREAM_MAX_COUNT; i++) YAGI_FREE(ctx->quad_streams[i].quads);
+    for (size_t i = 0; i < YAGI_FONT_MAX_COUNT; i++) YAGI_FREE(ctx->glyph_luts[i].slots);
+    if (ctx->record_file != NULL) fclose(ctx->record_file);
+    if (ctx->replay_file != NULL) fclose(ctx->replay_file);
+    yagi__arena_free(&ctx->frame_arena);
+    const YagiBackend* backend = ctx->backend != NULL ? ctx->backend : &yagi_backend_raylib;
+    if (ctx->frame_cache.id != 0) backend->unload_cache(ctx->frame_cache);
+    YAGI_FREE(ctx);
+}
+
+YagiContext* yagi_ctx_make_current(YagiContext* ctx) {
+    YagiContext* previous = yagi__current_ctx;
+    yagi__current_ctx = ctx != NULL ? ctx : &yagi__default_ctx;
+    return previous;
+}
+
+YagiContext* yagi_ctx_current() {
+    return yagi__current_ctx;
+}
+
+void yagi_ctx_set_deferred(YagiContext* ctx, bool deferred) {
+    ctx->deferred = deferred;
+}
+
+void yagi_ctx_composite(YagiContext* ctx) {
+    if (ctx->start_counter > 0) {
+        fprintf(stderr, "[YAGI] Context composited between yagi_ui_begin and yagi_ui_end\n");
+        abort();
+    }
+
+    YagiContext* previous = yagi_ctx_make_current(ctx);
+    if (!yagi_ui.cmds_sorted) yagi__sort_cmds();
+    yagi_ui.cmds_sorted = true;
+    yagi__flush_cmds();
+#ifndef YAGI_NO_STATS
+    // Drawn after yagi_ui_end, the calls belong to the frame that recorded them
+    if (yagi_ui.stats_history_count > 0) {
+        yagi_ui.stats_history[(yagi_ui.stats_history_next + YAGI_STATS_FRAMES - 1) % YAGI_STATS_FRAMES].draw_calls += yagi_ui.stats.draw_calls;
+    }
+    yagi_ui.stats.draw_calls = 0;
+#endif // YAGI_NO_STATS
+    if (yagi_ui.copy_set) yagi__backend()->set_clipboard(yagi_ui.copy_text);
+    yagi_ui.copy_set = false;
+    yagi_ctx_make_current(previous);
+}
+
+void yagi_ctx_set_input(YagiContext* ctx, const YagiInputSnapshot* snapshot) {
+    YagiContext* previous = yagi_ctx_make_current(ctx);
+    yagi_ui.next_input = snapshot->input;
+    yagi_ui.next_input_set = true;
+    yagi_ui.log_clipboard_set = false;
+    if (snapshot->clipboard_set) yagi__log_clipboard_set(snapshot->clipboard, strlen(snapshot->clipboard));
+    yagi_ctx_make_current(previous);
+}
+
+// Runs call with ctx made current
+#define YAGI__WITH_CTX(ctx, call) do { \
+        YagiContext* yagi__previous_ctx = yagi_ctx_make_current(ctx); \
+        call; \
+        yagi_ctx_make_current(yagi__previous_ctx); \
+    } while (0)
+
+bool yagi_ctx_needs_frame(YagiContext* ctx) {
+    bool result;
+    YAGI__WITH_CTX(ctx, result = yagi_ui_needs_frame());
+    return result;
+}
+
+UIID yagi_ctx_id_with_loc(YagiContext* ctx, const char* file, int line) {
+    UIID result;
+    YAGI__WITH_CTX(ctx, result = yagi_id_with_loc(file, line));
+    return result;
+}
+
+void yagi_ctx_ui_begin_with_loc(YagiContext* ctx, const char* file, int line) {
+    YAGI__WITH_CTX(ctx, yagi_ui_begin_with_loc(file, line));
+}
+
+void yagi_ctx_begin_layout_with_loc(YagiContext* ctx, LayoutType type, Vector2 pos, float padding, const char* file, int line) {
+    YAGI__WITH_CTX(ctx, yagi_begin_layout_with_loc(type, pos, padding, file, line));
+}
+
+void yagi_ctx_begin_sublayout_with_loc(YagiContext* ctx, LayoutType type, float padding, const char* file, int line) {
+    YAGI__WITH_CTX(ctx, yagi_begin_sublayout_with_loc(type, padding, file, line));
+}
+
+void yagi_ctx_end_layout_with_loc(YagiContext* ctx, const char* file, int line) {
+    YAGI__WITH_CTX(ctx, yagi_end_layout_with_loc(file, line));
+}
+
+Vector2 yagi_ctx_next_widget_pos_with_loc(YagiContext* ctx, const char* file, int line) {
+    Vector2 result;
+    YAGI__WITH_CTX(ctx, result = yagi_next_widget_pos_with_loc(file, line));
+    return result;
+}
+
+void yagi_ctx_expand_layout_with_loc(YagiContext* ctx, Vector2 size, const char* file, int line) {
+    YAGI__WITH_CTX(ctx, yagi_expand_layout_with_loc(size, file, line));
+}
+
+void yagi_ctx_begin_scroll_with_loc(YagiContext* ctx, Vector2 size, YagiScroll* scroll, const char* file, int line) {
+    YAGI__WITH_CTX(ctx, yagi_begin_scroll_with_loc(size, scroll, file, line));
+}
+
+void yagi_ctx_end_scroll_with_loc(YagiContext* ctx, const char* file, int line) {
+    YAGI__WITH_CTX(ctx, yagi_end_scroll_with_loc(file, line));
+}
+
+void yagi_ctx_begin_container_with_loc(YagiContext* ctx, LayoutType type, Vector2 size, YagiAlign justify, float padding, const char* file, int line) {
+    YAGI__WITH_CTX(ctx, yagi_begin_container_with_loc(type, size, justify, padding, file, line));
+}
+
+void yagi_ctx_flex_with_loc(YagiContext* ctx, YagiFlex flex, const char* file, int line) {
+    YAGI__WITH_CTX(ctx, yagi_flex_with_loc(flex, file, line));
+}
+
+void yagi_ctx_begin_rows_with_loc(YagiContext* ctx, float row_height, size_t row_count, size_t* first, size_t* last, const char* file, int line) {
+    YAGI__WITH_CTX(ctx, yagi_begin_rows_with_loc(row_height, row_count, first, last, file, line));
+}
+
+void yagi_ctx_end_rows_with_loc(YagiContext* ctx, const char* file, int line) {
+    YAGI__WITH_CTX(ctx, yagi_end_rows_with_loc(file, line));
+}
+
+void yagi_ctx_ui_end_with_loc(YagiContext* ctx, const char* file, int line) {
+    YAGI__WITH_CTX(ctx, yagi_ui_end_with_loc(file, line));
+}
+
+void yagi_ctx_text_with_loc(YagiContext* ctx, const char* file, int line, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    YAGI__WITH_CTX(ctx, yagi__vtext_with_loc(file, line, fmt, args));
+    va_end(args);
+}
+
+void yagi_ctx_empty_with_loc(YagiContext* ctx, Vector2 size, const char* file, int line) {
+    YAGI__WITH_CTX(ctx, yagi_empty_with_loc(size, file, line));
+}
+
+bool yagi_ctx_button_with_loc(YagiContext* ctx, const char* label, const char* file, int line) {
+    bool result;
+    YAGI__WITH_CTX(ctx, result = yagi_button_with_loc(label, file, line));
+    return result;
+}
+
+bool yagi_ctx_dropdown_with_loc(YagiContext* ctx, int* already_selected, char* labels[], size_t label_count, const char* file, int line) {
+    bool result;
+    YAGI__WITH_CTX(ctx, result = yagi_dropdown_with_loc(already_selected, labels, label_count, file, line));
+    return result;
+}
+
+bool yagi_ctx_dropdown_filtered_with_loc(YagiContext* ctx, int* already_selected, char* labels[], size_t label_count, YagiDropdownFilter* filter, const char* file, int line) {
+    bool result;
+    YAGI__WITH_CTX(ctx, result = yagi_dropdown_filtered_with_loc(already_selected, labels, label_count, filter, file, line));
+    return result;
+}
+
+bool yagi_ctx_input_with_loc(YagiContext* ctx, int width, InputBuffer* input_buffer, const char* file, int line) {
+    bool result;
+    YAGI__WITH_CTX(ctx, result = yagi_input_with_loc(width, input_buffer, file, line));
+    return result;
+}
+
+bool yagi_ctx_slider_with_loc(YagiContext* ctx, int width, float* value_ptr, const char* file, int line) {
+    bool result;
+    YAGI__WITH_CTX(ctx, result = yagi_slider_with_loc(width, value_ptr, file, line));
+    return result;
+}
+
+bool yagi_ctx_checkbox_with_loc(YagiContext* ctx, Vector2 size, bool* checked_ptr, const char* file, int line) {
+    bool result;
+    YAGI__WITH_CTX(ctx, result = yagi_checkbox_with_loc(size, checked_ptr, file, line));
+    return result;
+}
+
+void yagi_ctx_table_with_loc(YagiContext* ctx, Vector2 size, YagiTable* table, YagiScroll* scroll, const char* file, int line) {
+    YAGI__WITH_CTX(ctx, yagi_table_with_loc(size, table, scroll, file, line));
+}
+
+void yagi_ctx_stats_overlay_with_loc(YagiContext* ctx, const char* file, int line) {
+    YAGI__WITH_CTX(ctx, yagi_stats_overlay_with_loc(file, line));
+}
+
 #endif // YAGI_IMPLEMENTATION